@@ -0,0 +1,96 @@
+#include <cmath>
+
+#include "frustum.h"
+
+frustum::frustum(const glm::mat4 &pv) {
+    /* glm is column major, row i is (pv[0][i], pv[1][i], pv[2][i], pv[3][i]) */
+    auto row = [&](int i) {
+        return glm::vec4(pv[0][i], pv[1][i], pv[2][i], pv[3][i]);
+    };
+
+    glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+    planes[0] = r3 + r0;    // left
+    planes[1] = r3 - r0;    // right
+    planes[2] = r3 + r1;    // bottom
+    planes[3] = r3 - r1;    // top
+    planes[4] = r3 + r2;    // near
+    planes[5] = r3 - r2;    // far
+
+    for (auto &p:planes) {
+        float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        if (len > 0.0f) {
+            p = p / len;
+        }
+    }
+}
+
+bool frustum::intersects(const AABB &world_aabb) const {
+    vec3 c = 0.5f * (world_aabb.p0 + world_aabb.p1);
+    vec3 e = 0.5f * (world_aabb.p1 - world_aabb.p0);
+    for (auto &p:planes) {
+        float r = std::abs(p.x) * e.x + std::abs(p.y) * e.y + std::abs(p.z) * e.z;
+        if (p.x * c.x + p.y * c.y + p.z * c.z + p.w + r < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t frustum_culler::cull(const frustum &f,
+                            const std::vector<AABB> &bounds,
+                            const std::vector<glm::mat4> &worlds,
+                            std::vector<unsigned char> &visible) {
+    const int n = (int)bounds.size();
+    visible.assign(n, 0);
+    if (n == 0) {
+        return 0;
+    }
+
+    m_cx.resize(n); m_cy.resize(n); m_cz.resize(n);
+    m_ex.resize(n); m_ey.resize(n); m_ez.resize(n);
+
+    /* World space center/extent, empty boxes get a negative extent and never pass */
+#pragma omp parallel for if(n > 4096)
+    for (int i = 0; i < n; ++i) {
+        const AABB &b = bounds[i];
+        const glm::mat4 &m = worlds[i];
+        if (b.p0.x > b.p1.x || b.p0.y > b.p1.y || b.p0.z > b.p1.z) {
+            m_cx[i] = m_cy[i] = m_cz[i] = 0.0f;
+            m_ex[i] = m_ey[i] = m_ez[i] = -FLT_MAX;
+            continue;
+        }
+
+        vec3 c = 0.5f * (b.p0 + b.p1);
+        vec3 e = 0.5f * (b.p1 - b.p0);
+        vec3 wc, we;
+        for (int r = 0; r < 3; ++r) {
+            wc[r] = m[0][r] * c.x + m[1][r] * c.y + m[2][r] * c.z + m[3][r];
+            we[r] = std::abs(m[0][r]) * e.x + std::abs(m[1][r]) * e.y + std::abs(m[2][r]) * e.z;
+        }
+        m_cx[i] = wc.x; m_cy[i] = wc.y; m_cz[i] = wc.z;
+        m_ex[i] = we.x; m_ey[i] = we.y; m_ez[i] = we.z;
+    }
+
+    const float *cx = m_cx.data(), *cy = m_cy.data(), *cz = m_cz.data();
+    const float *ex = m_ex.data(), *ey = m_ey.data(), *ez = m_ez.data();
+    unsigned char *vis = visible.data();
+    for (int i = 0; i < n; ++i) {
+        vis[i] = 1;
+    }
+
+    for (auto &p:f.planes) {
+        const float px = p.x, py = p.y, pz = p.z, pw = p.w;
+        const float ax = std::abs(px), ay = std::abs(py), az = std::abs(pz);
+#pragma omp simd
+        for (int i = 0; i < n; ++i) {
+            float d = px * cx[i] + py * cy[i] + pz * cz[i] + pw + ax * ex[i] + ay * ey[i] + az * ez[i];
+            vis[i] &= (unsigned char)(d >= 0.0f);
+        }
+    }
+
+    size_t ret = 0;
+    for (int i = 0; i < n; ++i) {
+        ret += vis[i];
+    }
+    return ret;
+}
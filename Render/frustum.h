@@ -0,0 +1,36 @@
+/* View frustum culling
+ *
+ *  Planes are extracted from P * V (Gribb & Hartmann) and stored as
+ *  (n, d) with dot(n, p) + d >= 0 inside.
+ *
+ *  frustum_culler tests a whole pass at once: model-space AABBs are moved to
+ *  world space with Arvo's method (center by M, extent by |M|), laid out as
+ *  structure of arrays, and every plane is tested over all objects in one
+ *  vectorized loop.
+ * */
+#pragma once
+#include <vector>
+
+#include "mesh.h"
+
+struct frustum {
+    glm::vec4 planes[6];
+
+    frustum() = default;
+    explicit frustum(const glm::mat4 &pv);
+
+    /* False only if the box is fully outside one plane */
+    bool intersects(const AABB &world_aabb) const;
+};
+
+class frustum_culler {
+public:
+    /* visible[i] = 1 if bounds[i] under worlds[i] may be visible. Returns the visible count */
+    size_t cull(const frustum &f,
+                const std::vector<AABB> &bounds,
+                const std::vector<glm::mat4> &worlds,
+                std::vector<unsigned char> &visible);
+
+private:
+    std::vector<float> m_cx, m_cy, m_cz, m_ex, m_ey, m_ez;
+};
@@ -1,7 +1,7 @@
 #include "mesh.h"
 #include "Utilities/model_loader.h"
 
-int mesh::id = 0;
+std::atomic<int> mesh::id(0);
 
 void AABB::add_point(vec3 p) {
     p0.x = std::min(p.x, p0.x);
@@ -42,17 +42,29 @@ bool AABB::collide(AABB b) {
 }
 
 AABB AABB::transform(mat4 m) {
-    auto mat_vec3 = [](mat4 m, vec3 p) {
-        vec4 tmp = vec4(p, 1.0f);
-        tmp = m * tmp;
+	if (p0.x > p1.x || p0.y > p1.y || p0.z > p1.z) {
+		return *this;
+	}
 
-        return vec3(tmp / tmp.w);
-    };
+	/* Affine: Arvo's method, center by m and extent by |m| */
+	if (m[0][3] == 0.0f && m[1][3] == 0.0f && m[2][3] == 0.0f && m[3][3] == 1.0f) {
+		vec3 c = center(), e = 0.5f * diagonal();
+		vec3 wc, we;
+		for (int r = 0; r < 3; ++r) {
+			wc[r] = m[0][r] * c.x + m[1][r] * c.y + m[2][r] * c.z + m[3][r];
+			we[r] = std::abs(m[0][r]) * e.x + std::abs(m[1][r]) * e.y + std::abs(m[2][r]) * e.z;
+		}
+		return AABB(wc - we, wc + we);
+	}
 
-    AABB ret = *this;
-    ret.p0 = mat_vec3(m, ret.p0);
-    ret.p1 = mat_vec3(m, ret.p1);
-    return ret;
+	/* Projective: all 8 corners with the w divide */
+	AABB ret;
+	for (int k = 0; k < 8; ++k) {
+		vec3 corner((k & 1) ? p1.x : p0.x, (k & 2) ? p1.y : p0.y, (k & 4) ? p1.z : p0.z);
+		vec4 tmp = m * vec4(corner, 1.0f);
+		ret.add_point(vec3(tmp / tmp.w));
+	}
+	return ret;
 }
 
 std::string AABB::to_string() {
@@ -61,10 +73,85 @@ std::string AABB::to_string() {
     return oss.str();
 }
 
-mesh::mesh(){
+const AABB& mesh_geometry::get_bounds() {
+	if (bounds_version != version || bounds_count != verts.size()) {
+		update_bounds();
+	}
+	return cached_bounds;
+}
+
+vec3 mesh_geometry::get_center() {
+	if (bounds_version != version || bounds_count != verts.size()) {
+		update_bounds();
+	}
+	return cached_center;
+}
+
+void mesh_geometry::update_bounds() {
+	AABB ret;
+	vec3 sum(0.0f);
+	const int n = (int)verts.size();
+#pragma omp parallel if(n > 1 << 16)
+	{
+		AABB local;
+		vec3 local_sum(0.0f);
+#pragma omp for nowait
+		for (int i = 0; i < n; ++i) {
+			local.add_point(verts[i]);
+			local_sum += verts[i];
+		}
+#pragma omp critical
+		{
+			if (local.p0.x <= local.p1.x) {
+				ret.add_aabb(local);
+			}
+			sum += local_sum;
+		}
+	}
+
+	cached_bounds = ret;
+	cached_center = n > 0 ? sum / (float)n : vec3(0.0f);
+	bounds_version = version;
+	bounds_count = verts.size();
+	++bounds_generation;
+}
+
+mesh::mesh():mesh(std::make_shared<mesh_geometry>()) {
+}
+
+mesh::mesh(std::shared_ptr<mesh_geometry> geometry):
+    m_geometry(geometry ? geometry : std::make_shared<mesh_geometry>()),
+    m_verts(m_geometry->verts),
+    m_norms(m_geometry->norms),
+    m_colors(m_geometry->colors),
+    m_uvs(m_geometry->uvs) {
+    init();
+}
+
+mesh::mesh(std::shared_ptr<mesh_geometry> geometry, const mesh &rhs):
+    m_geometry(geometry),
+    m_world(rhs.m_world),
+    m_verts(m_geometry->verts),
+    m_norms(m_geometry->norms),
+    m_colors(rhs.m_colors),
+    m_uvs(m_geometry->uvs),
+    file_path(rhs.file_path),
+    m_vs(rhs.m_vs),
+    m_fs(rhs.m_fs),
+    m_is_selected(rhs.m_is_selected),
+    m_is_emitter(rhs.m_is_emitter),
+    m_is_caster(rhs.m_is_caster) {
     init();
 }
 
+std::shared_ptr<mesh> mesh::share_instance() const {
+    return std::shared_ptr<mesh>(new mesh(m_geometry, *this));
+}
+
+std::shared_ptr<mesh> mesh::copy_unique() const {
+    return std::shared_ptr<mesh>(new mesh(std::make_shared<mesh_geometry>(*m_geometry), *this));
+}
+
 mesh::~mesh() {
 }
 
@@ -88,12 +175,7 @@ std::vector<vec3> mesh::compute_world_space_normals() {
 }
 
 vec3 mesh::compute_center() {
-	vec3 center(0.0f, 0.0f, 0.0f);
-	float weights = 1.0f/(float)m_verts.size();
-	for (auto& v : m_verts) {
-		center += v * weights;
-	}
-	return center;
+	return m_geometry->get_center();
 }
 
 vec3 mesh::compute_world_center() {
@@ -134,12 +216,16 @@ void mesh::add_face(vec3 va, vec3 vb, vec3 vc) {
 	m_colors.push_back(default_stl_color);
 	m_colors.push_back(default_stl_color);
 	m_colors.push_back(default_stl_color);
+	mark_geometry_dirty();
+	mark_colors_dirty();
 }
 
 void mesh::add_vertex(vec3 v, vec3 n, vec3 c) {
 	m_verts.push_back(v);
 	m_norms.push_back(n);
 	m_colors.push_back(c);
+	mark_geometry_dirty();
+	mark_colors_dirty();
 }
 
 void mesh::add_vertex(vec3 v, vec3 n, vec3 c, vec2 uv) {
@@ -149,29 +235,25 @@ void mesh::add_vertex(vec3 v, vec3 n, vec3 c, vec2 uv) {
 
 void mesh::add_vertices(std::vector<vec3>& verts) {
 	m_verts.insert(m_verts.end(), verts.begin(), verts.end());
+	mark_geometry_dirty();
 }
 
 AABB mesh::compute_aabb() const {
 	assert(m_verts.size() > 0);
-
-	AABB aabb(m_verts[0]);
-	for (auto &v : m_verts) {
-		aabb.add_point(v);
-	}
-	return aabb;
+	return m_geometry->get_bounds();
 }
 
 AABB mesh::compute_world_aabb() {
-	auto world_space_points = compute_world_space_coords();
-	if (world_space_points.empty())
+	if (m_verts.empty())
 		return AABB(vec3(0.0f));
 
-	AABB aabb(world_space_points[0]);
-	for (auto& v : world_space_points) {
-		aabb.add_point(v);
+	const AABB &local = m_geometry->get_bounds();
+	if (m_world_aabb_generation != m_geometry->bounds_generation || m_world_aabb_mat != m_world) {
+		m_world_aabb = AABB(local).transform(m_world);
+		m_world_aabb_mat = m_world;
+		m_world_aabb_generation = m_geometry->bounds_generation;
 	}
-
-	return aabb;
+	return m_world_aabb;
 }
 
 void mesh::set_color(vec3 col) {
@@ -187,7 +269,7 @@ void mesh::set_color(vec3 col) {
 			c = col;
 		}
 	}
-
+	mark_colors_dirty();
 }
 
 void mesh::set_color(unsigned triangle_id, vec3 col) {
@@ -198,6 +280,31 @@ void mesh::set_color(unsigned triangle_id, vec3 col) {
 
 	unsigned int vi = 3 * triangle_id + 0, vj = 3 * triangle_id + 1, vk = 3 * triangle_id + 2;
 	m_colors[vi] = m_colors[vj] = m_colors[vk] = col;
+	mark_colors_dirty();
+}
+
+bool mesh::uniform_color(vec3 &col) const {
+	/* Missing colors are drawn black */
+	if (m_colors.empty() || m_colors.size() != m_verts.size()) {
+		col = vec3(0.0f);
+		return true;
+	}
+
+	if (m_uniform_color_version != m_color_version || m_uniform_color_count != m_colors.size()) {
+		m_uniform_color = m_colors[0];
+		m_is_uniform_color = true;
+		for (auto &c : m_colors) {
+			if (c.x != m_uniform_color.x || c.y != m_uniform_color.y || c.z != m_uniform_color.z) {
+				m_is_uniform_color = false;
+				break;
+			}
+		}
+		m_uniform_color_version = m_color_version;
+		m_uniform_color_count = m_colors.size();
+	}
+
+	col = m_uniform_color;
+	return m_is_uniform_color;
 }
 
 void mesh::normalize_position_orientation(vec3 scale/*=vec3(1.0f)*/, glm::quat rot_quant /*= glm::quat(0.0f,0.0f,0.0f,1.0f)*/) {
@@ -240,6 +347,7 @@ void mesh::recompute_normal() {
 		m_norms.push_back(n);
 		m_norms.push_back(n);
 	}
+	mark_geometry_dirty();
 }
 
 void mesh::remove_duplicate_vertices() {
@@ -254,6 +362,7 @@ void mesh::remove_duplicate_vertices() {
 			}
 		}
 	}
+	mark_geometry_dirty();
 }
 
 std::vector<glm::vec3> AABB::to_tri_mesh() {
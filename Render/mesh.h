@@ -1,6 +1,7 @@
 #pragma once
 #include <common.h>
 #include <cfloat>
+#include <atomic>
 
 using glm::ivec2;
 using glm::vec2;
@@ -34,9 +35,55 @@ struct AABB
 	std::vector<glm::vec3> to_line_mesh();
 };
 
+/*
+* Sub-mesh, a range of vertices in the triangle soup. Metadata only, the
+* renderer draws the whole soup at once; tools read it with mesh::get_parts()
+**/
+struct mesh_part {
+	std::string name;
+	size_t first, count;
+};
+
+/*
+* Vertex data of a mesh, shared by every instance of the same asset.
+* Geometry from the asset cache must be treated as immutable, call
+* mesh::copy_unique() to get an editable copy. Writers that touch the
+* arrays directly should call mark_dirty() so GPU copies are refreshed.
+**/
+struct mesh_geometry {
+	std::vector<vec3> verts;
+	std::vector<vec3> norms;
+	std::vector<vec2> uvs;
+	std::vector<vec3> colors;	// colors stored in the file (e.g. PLY scans), initial colors of new instances
+	std::vector<mesh_part> parts;	// sub-meshes, empty if the file has one
+	uint64_t version = 0;
+
+	void mark_dirty() { ++version; }
+	size_t bytes() const {
+		return (verts.capacity() + norms.capacity() + colors.capacity()) * sizeof(vec3) + uvs.capacity() * sizeof(vec2);
+	}
+
+	/* Model space bounds and vertex centroid, recomputed only after the version 
+	 * or the vertex count changes. Empty AABB if no vertex */
+	const AABB& get_bounds();
+	vec3 get_center();
+
+	AABB cached_bounds;
+	vec3 cached_center = vec3(0.0f);
+	uint64_t bounds_version = UINT64_MAX;
+	uint64_t bounds_generation = 0;		// bumped on every recompute
+	size_t bounds_count = 0;
+
+private:
+	void update_bounds();
+};
+
 class mesh : public ISerialize {
 public:
 	mesh();
+	mesh(std::shared_ptr<mesh_geometry> geometry);  // new instance of existing geometry
+	mesh(const mesh &rhs) = delete;                 // use share_instance() or copy_unique()
+	mesh& operator=(const mesh &rhs) = delete;
 	~mesh();
 
     /* Interface */
@@ -59,16 +106,19 @@ public:
 	void add_vertex(vec3 v, vec3 n, vec3 c, vec2 uv);
 	void add_vertices(std::vector<vec3>& verts);
 
-	AABB compute_aabb() const;
-	AABB compute_world_aabb();
+	AABB compute_aabb() const;	// cached, see mesh_geometry::get_bounds
+	AABB compute_world_aabb();	// cached until m_world or the geometry changes
 	void set_color(vec3 col);
 	void set_color(unsigned triangle_id, vec3 col);
+	bool uniform_color(vec3 &col) const;	// true if every vertex has the same color (black if none), cached
+	void mark_colors_dirty() { ++m_color_version; }	// call after writing m_colors directly
+	uint64_t get_color_version() const { return m_color_version; }
 	void normalize_position_orientation(vec3 scale=vec3(1.0f), 
 										glm::quat rot_quant = glm::quat(0.0f,0.0f,0.0f,0.0f));
 	
 	void get_demose_matrix(vec3& scale, quat& rot, vec3& translate);
 	void set_matrix(const vec3 scale, const quat rot, const vec3 translate);
-	void clear_vertices() { m_world = glm::identity<mat4>(); m_verts.clear(); m_norms.clear(); m_colors.clear(); m_uvs.clear(); }
+	void clear_vertices() { m_world = glm::identity<mat4>(); m_verts.clear(); m_norms.clear(); m_colors.clear(); m_uvs.clear(); m_geometry->colors.clear(); m_geometry->parts.clear(); mark_geometry_dirty(); mark_colors_dirty(); }
 	void recompute_normal();
 	void remove_duplicate_vertices();
 	std::string to_string() {
@@ -86,26 +136,52 @@ public:
 	bool is_light() { return m_is_emitter; }
 	void set_verts(std::vector<vec3> &verts) {
 		m_verts = verts;
+		mark_geometry_dirty();
 	}
     void set_caster(bool is_caster) { m_is_caster = is_caster;} 
     bool get_caster() { return m_is_caster; } 
 
+	/* Geometry sharing */
+	std::shared_ptr<mesh_geometry> get_geometry() const { return m_geometry; }
+	bool is_geometry_shared() const { return m_geometry.use_count() > 1; }
+	bool has_file_colors() const { return !m_geometry->colors.empty(); }
+	const std::vector<mesh_part>& get_parts() const { return m_geometry->parts; }
+	std::shared_ptr<mesh> share_instance() const;	// same instance state, shares the geometry
+	std::shared_ptr<mesh> copy_unique() const;	// same instance state, own copy of the geometry for editing
+	void mark_geometry_dirty() { m_geometry->mark_dirty(); }
+
 	//------- member variables --------//
+private:
+	std::shared_ptr<mesh_geometry> m_geometry;	// declared first, the references below bind to it
+
 public:
 	mat4 m_world = glm::mat4(1.0f); // model space -> world space
-	std::vector<vec3> m_verts;
-	std::vector<vec3> m_norms;
-	std::vector<vec3> m_colors;
-	std::vector<vec2> m_uvs;
+	std::vector<vec3> &m_verts;		// -> m_geometry
+	std::vector<vec3> &m_norms;		// -> m_geometry
+	std::vector<vec3> m_colors;		// per instance
+	std::vector<vec2> &m_uvs;		// -> m_geometry
 	std::string file_path;
 	
 	std::string m_vs, m_fs;
 	int cur_id = -1;
-	static int id;
+	static std::atomic<int> id;	// meshes are also created by loader threads
 	bool m_is_selected = false;
 	bool m_is_emitter = false;
     bool m_is_caster = true;
 
 private:
+    mesh(std::shared_ptr<mesh_geometry> geometry, const mesh &instance);
+
+	/* World AABB cache, m_world is public so the matrix itself is the dirty check */
+	AABB m_world_aabb;
+	mat4 m_world_aabb_mat = mat4(0.0f);
+	uint64_t m_world_aabb_generation = UINT64_MAX;
+
+	/* m_colors version, uniform_color() result is kept until it changes */
+	uint64_t m_color_version = 0;
+	mutable uint64_t m_uniform_color_version = UINT64_MAX;
+	mutable size_t m_uniform_color_count = 0;
+	mutable bool m_is_uniform_color = false;
+	mutable vec3 m_uniform_color = vec3(0.0f);
     void init() { cur_id = ++id; };
 };
@@ -1,7 +1,11 @@
 #include "renderer.h"
+#include "vertex_arena.h"
 #include "Utilities/Utils.h"
 #include "common.h"
 
+/* Fewer copies than this are drawn one by one */
+static const size_t min_instances = 2;
+
 renderer::renderer() {
     const std::string template_vs = "Shaders/template_vs.glsl";
     const std::string template_fs = "Shaders/template_fs.glsl";
@@ -37,6 +41,9 @@ renderer::renderer() {
 
 
 void renderer::render(std::shared_ptr<scene> cur_scene, std::shared_ptr<ppc> cur_ppc) {
+    shader::collect_geometry_buffers();
+    vertex_arena::instance()->collect();
+
     if (m_transparent_OIT) {
         oit_render(cur_scene, cur_ppc);
     } else {
@@ -58,15 +65,125 @@ void renderer::set_OIT(bool trigger) {
     m_transparent_OIT = trigger;
 }
 
+void renderer::set_instancing(bool trigger) {
+    m_instancing = trigger;
+}
+
+void renderer::set_indirect(bool trigger) {
+    m_indirect = trigger;
+}
+
+void renderer::set_culling(bool trigger) {
+    m_culling = trigger;
+}
+
 void renderer::default_render(std::shared_ptr<scene> cur_scene, std::shared_ptr<ppc> cur_ppc, std::string shader_name) {
     rendering_params cur_render_params;
     cur_render_params.cur_camera = cur_ppc;
 
     auto rendered_meshes = cur_scene->get_mesh_descriptors();
-    for (auto mdesc:rendered_meshes) {
-        auto cur_desc = mdesc.second;
-        m_shaders[shader_name]->draw_mesh(*cur_desc, cur_render_params);
+    std::shared_ptr<shader> cur_shader = m_shaders.at(shader_name);
+
+    m_stats = frame_stats();
+    m_stats.objects = rendered_meshes.size();
+
+    /* Frustum test of every mesh before anything is submitted */
+    std::vector<std::shared_ptr<Mesh_Descriptor>> visible_descs;
+    visible_descs.reserve(rendered_meshes.size());
+    if (m_culling) {
+        std::vector<AABB> bounds;
+        std::vector<glm::mat4> cull_worlds;
+        std::vector<std::shared_ptr<Mesh_Descriptor>> candidates;
+        bounds.reserve(rendered_meshes.size());
+        cull_worlds.reserve(rendered_meshes.size());
+        candidates.reserve(rendered_meshes.size());
+        for (auto &mdesc:rendered_meshes) {
+            auto &m = mdesc.second->m;
+            if (m == nullptr) {
+                visible_descs.push_back(mdesc.second);
+                continue;
+            }
+            bounds.push_back(m->get_geometry()->get_bounds());
+            cull_worlds.push_back(m->m_world);
+            candidates.push_back(mdesc.second);
+        }
+
+        std::vector<unsigned char> visible;
+        frustum view_frustum(cur_ppc->GetP() * cur_ppc->GetV());
+        size_t visible_num = m_culler.cull(view_frustum, bounds, cull_worlds, visible);
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (visible[i]) {
+                visible_descs.push_back(candidates[i]);
+            }
+        }
+        m_stats.culled = candidates.size() - visible_num;
+    } else {
+        for (auto &mdesc:rendered_meshes) {
+            visible_descs.push_back(mdesc.second);
+        }
+    }
+
+    /* Untextured meshes with a single color that share geometry become one instanced group */
+    std::vector<instance_group> groups;
+    std::map<std::pair<const mesh_geometry*, int>, size_t> group_index;
+
+    bool instancing = m_instancing && cur_shader->supports_instancing();
+    for (auto &desc:visible_descs) {
+        auto &m = desc->m;
+        vec3 color;
+        if (!instancing || m == nullptr || !desc->texs.empty() || !m->uniform_color(color)) {
+            groups.push_back({desc, {}, {}});
+            continue;
+        }
+
+        auto key = std::make_pair(m->get_geometry().get(), (int)desc->type);
+        auto it = group_index.find(key);
+        if (it == group_index.end()) {
+            it = group_index.emplace(key, groups.size()).first;
+            groups.push_back({desc, {}, {}});
+        }
+        groups[it->second].worlds.push_back(m->m_world);
+        groups[it->second].colors.push_back(color);
+    }
+
+    /* With multi draw indirect every group is batched, even a single copy */
+    std::vector<instance_group> batched;
+
+    /* Per-frame and per-object uniform blocks are written once for the whole pass */
+    std::vector<glm::mat4> worlds;
+    worlds.reserve(groups.size());
+    for (auto &g:groups) {
+        if (m_indirect && !g.worlds.empty()) {
+            batched.push_back(std::move(g));
+        } else if (g.worlds.size() < min_instances) {
+            worlds.push_back(g.desc->m ? g.desc->m->m_world : glm::mat4(1.0f));
+        }
+    }
+
+    shader::upload_frame(cur_render_params);
+    uniform_buffers::instance()->set_objects(worlds);
+    cur_render_params.frame_ready = true;
+
+    int draw_id = 0;
+    for (auto &g:groups) {
+        if (g.desc == nullptr) {
+            continue;   // moved to the indirect batch
+        }
+
+        if (g.worlds.size() >= min_instances) {
+            cur_shader->draw_instanced(*g.desc, g.worlds, g.colors, cur_render_params);
+            m_stats.instanced_objects += g.worlds.size();
+        } else {
+            cur_render_params.draw_id = draw_id++;
+            cur_shader->draw_mesh(*g.desc, cur_render_params);
+        }
+        ++m_stats.draw_calls;
+    }
+
+    for (auto &g:batched) {
+        m_stats.instanced_objects += g.worlds.size();
     }
+    m_stats.draw_calls += cur_shader->draw_indirect(batched, cur_render_params);
 }
 
 void renderer::oit_render(std::shared_ptr<scene> cur_scene, std::shared_ptr<ppc> cur_ppc) {
@@ -158,11 +275,11 @@ void renderer::oit_render(std::shared_ptr<scene> cur_scene, std::shared_ptr<ppc>
     quad_shader->bind();
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, accum_texture);
-    glUniform1i(glGetUniformLocation(quad_shader->get_shader_program(), "accum_tex"), 0);
+    quad_shader->set_int("accum_tex", 0);
 
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, reveal_texture);
-    glUniform1i(glGetUniformLocation(quad_shader->get_shader_program(), "weight_tex"), 1);
+    quad_shader->set_int("weight_tex", 1);
 
     glViewport(0, 0, cur_ppc->width(), cur_ppc->height());
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
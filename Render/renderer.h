@@ -4,11 +4,25 @@
 #include "scene.h"
 #include "ppc.h"
 #include "shader.h"
+#include "frustum.h"
+
+/* Counters of the last default_render pass */
+struct frame_stats {
+    size_t objects = 0;         // descriptors in the scene
+    size_t culled = 0;          // outside the view frustum
+    size_t draw_calls = 0;
+    size_t instanced_objects = 0;   // drawn through instanced or indirect batches
+};
 
 class renderer {
 private:
     std::unordered_map<std::string, std::shared_ptr<shader>> m_shaders;
     bool m_transparent_OIT = true;
+    bool m_instancing = true;
+    bool m_indirect = true;
+    bool m_culling = true;
+    frame_stats m_stats;
+    frustum_culler m_culler;
     GLuint m_quad_vao=-1;
 
 public:
@@ -20,6 +34,22 @@ public:
      */
     void set_OIT(bool trigger);
 
+    /*
+     * Meshes sharing geometry are drawn with one instanced call
+     */
+    void set_instancing(bool trigger);
+
+    /*
+     * Instanced groups come from one shared vertex arena and are submitted with multi draw indirect
+     */
+    void set_indirect(bool trigger);
+
+    /*
+     * Skip meshes outside the camera frustum
+     */
+    void set_culling(bool trigger);
+    const frame_stats& get_frame_stats() const { return m_stats; }
+
 private:
     template<typename T>
     std::shared_ptr<shader> init_shaders(const std::string vs, const std::string fs);
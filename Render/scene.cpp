@@ -1,6 +1,9 @@
 #include <common.h>
 #include "scene.h"
 #include "Utilities/model_loader.h"
+#include "asset_manager.h"
+#include "Utilities/mesh_cache.h"
+#include "Utilities/thread_pool.h"
 
 scene::scene() {
 }
@@ -62,48 +65,65 @@ int scene::from_json(const std::string json_str) {
 
     const std::string mesh_key = "meshes";
     if (document.HasMember("meshes")) {
+        struct mesh_entry {
+            mesh_id id;
+            std::string path;
+            mat4 world_mat;
+            bool caster;
+            std::future<std::shared_ptr<mesh>> loaded;
+        };
+        std::vector<mesh_entry> entries;
+
+        /* Every mesh is loaded in parallel, the scene takes as long as the slowest file */
         auto cur_node = document[mesh_key.c_str()].GetObject();
         for (auto &member:cur_node) {
             //INFO("Find mesh {}", member.name.GetString());
-            mesh_id id = std::stoi(member.name.GetString());
-            if (mesh::id < id - 1) {
-                mesh::id = id - 1;
-            }
+            mesh_entry entry;
+            entry.id = std::stoi(member.name.GetString());
 
             auto mesh_obj = member.value.GetObject();
+            ret = ret & rapidjson_get_string(mesh_obj, "path", entry.path);
+            ret = ret & rapidjson_get_mat4(mesh_obj, "World Matrix", entry.world_mat);
+            ret = ret & rapidjson_get_bool(mesh_obj, "Caster", entry.caster);
+
+            if (purdue::file_exists(entry.path)) {
+                std::string path = entry.path;
+                entry.loaded = thread_pool::instance()->submit([path]() {
+                    return asset_manager::instance()->load_mesh(path);
+                });
+            }
+            entries.push_back(std::move(entry));
+        }
 
-            std::string mesh_path;
-            mat4 world_mat;
-            bool caster;
-
-            ret = ret & rapidjson_get_string(mesh_obj, "path", mesh_path);
-            ret = ret & rapidjson_get_mat4(mesh_obj, "World Matrix", world_mat);
-            ret = ret & rapidjson_get_bool(mesh_obj, "Caster", caster);
-
+        for (auto &entry:entries) {
             /* Initialize the mesh */
             std::shared_ptr<mesh> mesh_ptr;
-            if (purdue::file_exists(mesh_path)) {
-                mesh_ptr = add_mesh(mesh_path, vec3(0.7f));
+            if (entry.loaded.valid()) {
+                mesh_ptr = entry.loaded.get();
+            }
+
+            if (mesh_ptr) {
+                if (!mesh_ptr->has_file_colors()) {
+                    mesh_ptr->set_color(vec3(0.7f));
+                }
             } else {
-                WARN("Cannot find the mesh file({}). Use plane instead", mesh_path);
+                WARN("Cannot load the mesh file({}). Use plane instead", entry.path);
                 mesh_ptr = get_plane_mesh(vec3(0.f), vec3(0.0f,1.0f,0.0f));
-                mesh_ptr->set_caster(false);
-                m_meshes[mesh_ptr->get_id()] = std::make_shared<Mesh_Descriptor>(mesh_ptr);
             }
 
-            mesh_ptr->set_world_mat(world_mat);
-            mesh_ptr->set_caster(caster);
+            mesh_ptr->set_world_mat(entry.world_mat);
+            mesh_ptr->set_caster(entry.caster);
 
             /* Keep m_meshes key - id consistent */
-            if (mesh_ptr->get_id() != id) {
-                m_meshes.erase(mesh_ptr->get_id());
-                mesh_ptr->cur_id = id;
-                m_meshes[mesh_ptr->cur_id] = std::make_shared<Mesh_Descriptor>(mesh_ptr);
+            mesh_ptr->cur_id = entry.id;
+            m_meshes[entry.id] = std::make_shared<Mesh_Descriptor>(mesh_ptr);
+            if (mesh::id < entry.id) {
+                mesh::id = entry.id;
             }
+        }
 
-            for(auto m:m_meshes) {
-                DBG("Current meshes: {}, {}", m.first, m.second->m->get_id());
-            }
+        for(auto m:m_meshes) {
+            DBG("Current meshes: {}, {}", m.first, m.second->m->get_id());
         }
 
         if (document.HasMember("lights")) {
@@ -118,21 +138,96 @@ int scene::from_json(const std::string json_str) {
 }
 
 std::shared_ptr<mesh> scene::add_mesh(const std::string mesh_file, vec3 color) {
-    std::shared_ptr<mesh> new_mesh = std::make_shared<mesh>();
-
-    FAIL(new_mesh == nullptr || !load_model(mesh_file, new_mesh), "Mesh {} cannot be loaded.", mesh_file);
+    /* Geometry is shared with every other instance of this file */
+    std::shared_ptr<mesh> new_mesh = asset_manager::instance()->load_mesh(mesh_file);
+    FAIL(new_mesh == nullptr, "Mesh {} cannot be loaded.", mesh_file);
 
-    if (new_mesh->m_verts.size() != new_mesh->m_norms.size()) {
-        new_mesh->recompute_normal();
+    if (!new_mesh->has_file_colors()) {
+        new_mesh->set_color(color);
     }
-
-    new_mesh->set_color(color);
     int id = new_mesh->get_id();
     m_meshes[id] = std::make_shared<Mesh_Descriptor>(new_mesh);
 
     return new_mesh;
 }
 
+mesh_load_handle scene::add_mesh_async(const std::string mesh_file, vec3 color, mesh_ready_callback on_ready) {
+    auto proxy = make_proxy(mesh_file, color);
+    int id = proxy->get_id();
+    auto desc = std::make_shared<Mesh_Descriptor>(proxy);
+    desc->type = draw_type::line_segments;
+    m_meshes[id] = desc;
+
+    mesh_load_handle ret;
+    ret.id = id;
+    ret.ready = thread_pool::instance()->submit([mesh_file]() {
+        std::shared_ptr<mesh> m;
+        try {
+            m = asset_manager::instance()->load_mesh(mesh_file);
+        }
+        catch (std::exception &e) {
+            WARN(e.what());
+        }
+        return m;
+    }).share();
+
+    m_pending_loads.push_back({id, color, ret.ready, on_ready});
+    return ret;
+}
+
+int scene::process_async_loads() {
+    int ret = 0;
+    for (auto it = m_pending_loads.begin(); it != m_pending_loads.end();) {
+        if (it->ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+
+        std::shared_ptr<mesh> m = it->ready.get();
+        auto proxy = m_meshes.find(it->id);
+
+        if (!m) {
+            WARN("Mesh {} cannot be loaded.", proxy != m_meshes.end() ? proxy->second->m->file_path : "");
+            m_meshes.erase(it->id);
+        } else if (proxy != m_meshes.end()) {
+            /* Keep what was set on the proxy meanwhile */
+            if (!m->has_file_colors()) {
+                m->set_color(it->color);
+            }
+            m->set_world_mat(proxy->second->m->get_world_mat());
+            m->set_caster(proxy->second->m->get_caster());
+            m->cur_id = it->id;
+            m_meshes[it->id] = std::make_shared<Mesh_Descriptor>(m);
+            ++ret;
+        } else {
+            /* Removed while loading */
+            m.reset();
+        }
+
+        if (it->on_ready) {
+            it->on_ready(m);
+        }
+        it = m_pending_loads.erase(it);
+    }
+    return ret;
+}
+
+std::shared_ptr<mesh> scene::make_proxy(const std::string mesh_file, vec3 color) {
+    /* Use the real bounds if the mesh has a cache entry */
+    AABB bounds(vec3(-0.5f), vec3(0.5f));
+    mesh_cache_file cache;
+    if (purdue::open_mesh_cache(mesh_file, cache) && cache.vert_num > 0) {
+        bounds = AABB(cache.bb_min, cache.bb_max);
+    }
+
+    auto proxy = std::make_shared<mesh>();
+    for (auto &v:bounds.to_line_mesh()) {
+        proxy->add_vertex(v, vec3(0.0f, 1.0f, 0.0f), color);
+    }
+    proxy->file_path = mesh_file;
+    return proxy;
+}
+
 bool scene::load_scene(std::string scene_file) {
     //#todo_parse_scene
     //#todo_parse_ppc
@@ -155,6 +250,7 @@ bool scene::save_scene(const std::string filename) {
 
 void scene::clean_up() {
     m_meshes.clear();
+    m_pending_loads.clear();
     mesh::id = 0;
 }
 
@@ -244,7 +340,6 @@ void scene::focus_at(std::shared_ptr<ppc> camera, std::shared_ptr<mesh> m, glm::
 
     //vec3 meshes_center = m->compute_world_center();
 
-    AABB world_aabb = m->compute_world_aabb();
     vec3 meshes_center = m->compute_world_center();
     float mesh_length = m->compute_world_aabb().diag_length();
     if (mesh_length < 0.0001f)
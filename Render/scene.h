@@ -1,15 +1,37 @@
 #pragma once
 #include <common.h> 
+#include <functional>
+#include <future>
 
 #include "ppc.h"
 #include "mesh.h"
 #include "shader.h"
 
+typedef std::function<void(std::shared_ptr<mesh>)> mesh_ready_callback;
+
+/* Background mesh load
+ *  id:    valid right away, refers to a bounding box proxy until the mesh is in
+ *  ready: resolves on the loader thread, nullptr if loading failed
+ * The proxy is swapped for the mesh by scene::process_async_loads() on the
+ * render thread, the callback runs there too. */
+struct mesh_load_handle {
+    mesh_id id = -1;
+    std::shared_future<std::shared_ptr<mesh>> ready;
+};
+
 class scene : public ISerialize {
 protected:
     std::unordered_map<mesh_id, std::shared_ptr<Mesh_Descriptor>> m_meshes;
     std::vector<glm::vec2> m_lights;
 
+    struct pending_load {
+        mesh_id id;
+        vec3 color;
+        std::shared_future<std::shared_ptr<mesh>> ready;
+        mesh_ready_callback on_ready;
+    };
+    std::vector<pending_load> m_pending_loads;
+
 public:
 	scene();
 	~scene();
@@ -26,6 +48,11 @@ public:
 
 	std::shared_ptr<mesh> add_mesh(const std::string mesh_file, vec3 color=vec3(0.7f));
     std::shared_ptr<mesh> add_mesh(std::shared_ptr<mesh> m, draw_type type);
+    mesh_load_handle add_mesh_async(const std::string mesh_file, vec3 color=vec3(0.7f), mesh_ready_callback on_ready=nullptr);
+
+    /* Swap finished background loads in, call from the render thread. Returns #meshes swapped in */
+    int process_async_loads();
+    size_t pending_loads() { return m_pending_loads.size(); }
     bool remove_mesh(mesh_id id);
 
     bool set_draw_type(mesh_id id, draw_type type);
@@ -41,4 +68,7 @@ public:
 	void reset_camera(std::shared_ptr<ppc> camera);
 	void focus_at(std::shared_ptr<ppc> camera, std::shared_ptr<mesh> m, glm::vec3 relative_vec);
 	void scale(glm::vec3 s);
+
+private:
+    std::shared_ptr<mesh> make_proxy(const std::string mesh_file, vec3 color);
 };
@@ -3,13 +3,20 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
 
 #include "shader.h"
+#include "vertex_arena.h"
 
 using std::ifstream;
 using std::ios;
 
 #define BUFFER_OFFSET(i) ((char*)NULL + (i))
+std::unordered_map<const mesh_geometry*, geometry_buffer> shader::m_geometry_buffers;
+std::unordered_map<const mesh*, color_buffer> shader::m_color_buffers;
+
 shader::shader(const char* computeShaderFile) {
 	m_cs = computeShaderFile;
 	m_type = shader_type::compute_shader;
@@ -69,7 +76,7 @@ void printProgramLinkError(GLuint program) {
 
 bool shader::reload_shader() {
 	if(m_program != -1)
-		glDeleteShader(m_program);
+		glDeleteProgram(m_program);
 
 	switch (m_type) {
 	case shader_type::template_shader:
@@ -88,15 +95,119 @@ bool shader::reload_shader() {
 		return false;
 		break;
 	}
+
+	reflect();
 	return true;
 }
 
-void shader::draw_mesh(const Mesh_Descriptor &descriptor, rendering_params& params){
-	if (descriptor.m == nullptr) {
-		WARN("Shader input mesh is nullptr");
-		return;
+void shader::reflect() {
+	m_uniforms.clear();
+	m_attribs.clear();
+
+	GLint count = 0, max_len = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_len);
+	std::vector<GLchar> name(std::max(max_len, 1));
+	for (GLint i = 0; i < count; ++i) {
+		GLsizei len = 0; GLint size = 0; GLenum type = 0;
+		glGetActiveUniform(m_program, i, (GLsizei)name.size(), &len, &size, &type, name.data());
+		std::string uniform_name(name.data(), len);
+
+		/* Uniform block members have no location */
+		GLint loc = glGetUniformLocation(m_program, uniform_name.c_str());
+		if (loc == -1) continue;
+
+		/* Arrays are reported as "name[0]", also accept "name" */
+		m_uniforms[uniform_name] = loc;
+		size_t bracket = uniform_name.find('[');
+		if (bracket != std::string::npos) {
+			m_uniforms[uniform_name.substr(0, bracket)] = loc;
+		}
+	}
+
+	count = 0; max_len = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(m_program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_len);
+	name.resize(std::max(max_len, 1));
+	for (GLint i = 0; i < count; ++i) {
+		GLsizei len = 0; GLint size = 0; GLenum type = 0;
+		glGetActiveAttrib(m_program, i, (GLsizei)name.size(), &len, &size, &type, name.data());
+		std::string attrib_name(name.data(), len);
+		m_attribs[attrib_name] = glGetAttribLocation(m_program, attrib_name.c_str());
+	}
+
+	m_locs.pos_attr    = attrib_location("pos_attr");
+	m_locs.norm_attr   = attrib_location("norm_attr");
+	m_locs.col_attr    = attrib_location("col_attr");
+	m_locs.uv_attr     = attrib_location("uv_attr");
+	m_locs.pvm         = uniform_location("PVM");
+	m_locs.p           = uniform_location("P");
+	m_locs.v           = uniform_location("V");
+	m_locs.m           = uniform_location("M");
+	m_locs.light_pos   = uniform_location("light_pos");
+	m_locs.light_pv    = uniform_location("light_pv");
+	m_locs.shadow_map  = uniform_location("shadow_map");
+	m_locs.draw_shadow = uniform_location("draw_shadow");
+	m_locs.instanced   = uniform_location("instanced");
+	m_locs.inst_world  = attrib_location("inst_world");
+	m_locs.inst_normal_mat = attrib_location("inst_normal_mat");
+
+	m_locs.frame_block  = glGetUniformBlockIndex(m_program, "frame_block");
+	m_locs.object_block = glGetUniformBlockIndex(m_program, "object_block");
+	if (m_locs.frame_block != GL_INVALID_INDEX) {
+		glUniformBlockBinding(m_program, m_locs.frame_block, frame_block_binding);
 	}
+	if (m_locs.object_block != GL_INVALID_INDEX) {
+		glUniformBlockBinding(m_program, m_locs.object_block, object_block_binding);
+	}
+}
+
+GLint shader::uniform_location(const std::string &name) const {
+	auto it = m_uniforms.find(name);
+	return it == m_uniforms.end() ? -1 : it->second;
+}
+
+GLint shader::attrib_location(const std::string &name) const {
+	auto it = m_attribs.find(name);
+	return it == m_attribs.end() ? -1 : it->second;
+}
+
+void shader::set_int(const std::string &name, int v) const {
+	GLint loc = uniform_location(name);
+	if (loc != -1) glUniform1i(loc, v);
+}
+
+void shader::set_float(const std::string &name, float v) const {
+	GLint loc = uniform_location(name);
+	if (loc != -1) glUniform1f(loc, v);
+}
 
+void shader::set_vec2(const std::string &name, const glm::vec2 &v) const {
+	GLint loc = uniform_location(name);
+	if (loc != -1) glUniform2f(loc, v.x, v.y);
+}
+
+void shader::set_vec3(const std::string &name, const glm::vec3 &v) const {
+	GLint loc = uniform_location(name);
+	if (loc != -1) glUniform3f(loc, v.x, v.y, v.z);
+}
+
+void shader::set_vec4(const std::string &name, const glm::vec4 &v) const {
+	GLint loc = uniform_location(name);
+	if (loc != -1) glUniform4f(loc, v.x, v.y, v.z, v.w);
+}
+
+void shader::set_mat3(const std::string &name, const glm::mat3 &v) const {
+	GLint loc = uniform_location(name);
+	if (loc != -1) glUniformMatrix3fv(loc, 1, false, glm::value_ptr(v));
+}
+
+void shader::set_mat4(const std::string &name, const glm::mat4 &v) const {
+	GLint loc = uniform_location(name);
+	if (loc != -1) glUniformMatrix4fv(loc, 1, false, glm::value_ptr(v));
+}
+
+void shader::bind_textures(const Mesh_Descriptor &descriptor) {
 	for (int i = 0; i < descriptor.texs.size(); ++i) {
 		if (descriptor.texs[i] == nullptr) {
 			WARN("{} texture is nullptr", i);
@@ -111,119 +222,464 @@ void shader::draw_mesh(const Mesh_Descriptor &descriptor, rendering_params& para
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	}
+}
 
-    auto m = descriptor.m;
-	GLuint vert_attr = glGetAttribLocation(m_program, "pos_attr");
-	GLuint norm_attr = glGetAttribLocation(m_program, "norm_attr");
-	GLuint col_attr = glGetAttribLocation(m_program, "col_attr");
-	GLuint uv_attr = glGetAttribLocation(m_program, "uv_attr");
-
-	static GLuint vao = -1, vbo = -1;
-	if (vao == -1) glGenVertexArrays(1, &vao);
-	if (vbo == -1) glGenBuffers(1, &vbo);
+/* Shared geometry attributes, into the bound VAO */
+void shader::bind_geometry(const geometry_buffer &gbuf) {
+	GLint vert_attr = m_locs.pos_attr;
+	GLint norm_attr = m_locs.norm_attr;
+	GLint uv_attr = m_locs.uv_attr;
 
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	
-	//------- Buffer update --------//
-	size_t buffer_size = (m->m_verts.size() + m->m_norms.size() + m->m_colors.size()) * sizeof(vec3) + m->m_uvs.size() * sizeof(vec2);
-	glBufferData(GL_ARRAY_BUFFER, buffer_size, 0, GL_DYNAMIC_DRAW);
-	if (m->m_verts.size() > 0 && vert_attr != -1) {
-		glBufferSubData(GL_ARRAY_BUFFER, 0, m->m_verts.size() * sizeof(vec3), &m->m_verts[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, gbuf.vbo);
+	if (vert_attr != -1) {
 		glVertexAttribPointer(vert_attr, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
 		glEnableVertexAttribArray(vert_attr);
 	}
-	if (m->m_norms.size() > 0 && norm_attr != -1) {
-		size_t offset = m->m_verts.size() * sizeof(vec3);
-		glBufferSubData(GL_ARRAY_BUFFER, offset, m->m_norms.size() * sizeof(vec3), &m->m_norms[0]);
-		glVertexAttribPointer(norm_attr, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
-		glEnableVertexAttribArray(norm_attr);
-	}
 
-	if (m->m_colors.size() > 0 && col_attr != -1) {
-		size_t offset = (m->m_verts.size() + m->m_norms.size()) * sizeof(vec3);
-		glBufferSubData(GL_ARRAY_BUFFER, offset, m->m_colors.size() * sizeof(vec3), &m->m_colors[0]);
-		glVertexAttribPointer(col_attr, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
-		glEnableVertexAttribArray(col_attr);
+	if (norm_attr != -1) {
+		if (gbuf.has_norm) {
+			glVertexAttribPointer(norm_attr, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(gbuf.norm_offset));
+			glEnableVertexAttribArray(norm_attr);
+		} else {
+			glDisableVertexAttribArray(norm_attr);
+		}
 	}
 
-	if (m->m_uvs.size() > 0 && uv_attr != -1) {
-		size_t offset = (m->m_verts.size() + m->m_norms.size() + m->m_colors.size()) * sizeof(vec3);
-		glBufferSubData(GL_ARRAY_BUFFER, offset, m->m_uvs.size() * sizeof(vec2), &m->m_uvs[0]);
-		glVertexAttribPointer(uv_attr, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
-		glEnableVertexAttribArray(uv_attr);
+	if (uv_attr != -1) {
+		if (gbuf.has_uv) {
+			glVertexAttribPointer(uv_attr, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(gbuf.uv_offset));
+			glEnableVertexAttribArray(uv_attr);
+		} else {
+			glDisableVertexAttribArray(uv_attr);
+		}
 	}
+}
 
-	glUseProgram(m_program);
-
-	mat4 p = params.cur_camera->GetP();
-	mat4 v = params.cur_camera->GetV();
-	mat4 pvm = p * v * m->m_world;
-	auto uniform_loc = glGetUniformLocation(m_program, "PVM");
-	glUniformMatrix4fv(uniform_loc, 1, false, glm::value_ptr(pvm));
-
-	uniform_loc = glGetUniformLocation(m_program, "P");
-	if(uniform_loc!=-1)
-		glUniformMatrix4fv(uniform_loc, 1, false, glm::value_ptr(p));
-
-	uniform_loc = glGetUniformLocation(m_program, "V");
-	if (uniform_loc != -1)
-		glUniformMatrix4fv(uniform_loc, 1, false, glm::value_ptr(v));
-
-	uniform_loc = glGetUniformLocation(m_program, "M");
-	if (uniform_loc != -1)
-		glUniformMatrix4fv(uniform_loc, 1, false, glm::value_ptr(m->m_world));
+/* Uniforms shared by every draw of a pass, program should be bound */
+void shader::set_pass_uniforms(rendering_params& params) {
+	if (m_locs.frame_block != GL_INVALID_INDEX && !params.frame_ready) {
+		upload_frame(params);
+	}
 
-	uniform_loc = glGetUniformLocation(m_program, "light_pos");
-	if (uniform_loc != -1 && !params.lights.empty()) {
+	if (m_locs.light_pos != -1 && !params.lights.empty()) {
 		//#todo_multiple_lights
-		glUniform3f(uniform_loc, params.lights[0].x, params.lights[0].y, params.lights[0].z);
+		glUniform3f(m_locs.light_pos, params.lights[0].x, params.lights[0].y, params.lights[0].z);
 	}
 
-	uniform_loc = glGetUniformLocation(m_program, "light_pv");
-	if (uniform_loc != -1 && params.light_camera) {
+	if (m_locs.light_pv != -1 && params.light_camera) {
 		glm::mat4 pv = params.light_camera->GetP() * params.light_camera->GetV();
-		glUniformMatrix4fv(uniform_loc, 1, false, glm::value_ptr(pv));
+		glUniformMatrix4fv(m_locs.light_pv, 1, false, glm::value_ptr(pv));
 	}
 
 	if (params.sm_texture != -1) {
 		glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, params.sm_texture);
-		auto uniform_loc = glGetUniformLocation(m_program, "shadow_map");
-		if(uniform_loc != -1) {
-			glUniform1i(uniform_loc, 0);
+		if (m_locs.shadow_map != -1) {
+			glUniform1i(m_locs.shadow_map, 0);
 		}
 
-		uniform_loc = glGetUniformLocation(m_program, "draw_shadow");
-		if(uniform_loc != -1) {
-			glUniform1i(uniform_loc, 1);
+		if (m_locs.draw_shadow != -1) {
+			glUniform1i(m_locs.draw_shadow, 1);
 		}
 
 	} else {
-		auto uniform_loc = glGetUniformLocation(m_program, "draw_shadow");
-		if(uniform_loc != -1) {
-			glUniform1i(uniform_loc, 0);
+		if (m_locs.draw_shadow != -1) {
+			glUniform1i(m_locs.draw_shadow, 0);
 		}
     }
+}
 
-	int ogl_draw_type = 0;
-	if (descriptor.type == draw_type::triangle) {
-		ogl_draw_type = GL_TRIANGLES;
-	} 
+static GLenum ogl_draw_type(draw_type type) {
+	switch (type) {
+	case draw_type::line_segments:
+		return GL_LINES;
+	case draw_type::points:
+		return GL_POINTS;
+	default:
+		return GL_TRIANGLES;
+	}
+}
 
-	if (descriptor.type == draw_type::line_segments) {
-		ogl_draw_type = GL_LINES;
+void shader::draw_mesh(const Mesh_Descriptor &descriptor, rendering_params& params){
+	if (descriptor.m == nullptr) {
+		WARN("Shader input mesh is nullptr");
+		return;
 	}
 
-    if (descriptor.type == draw_type::points) {
-        ogl_draw_type = GL_POINTS;
-    }
+	bind_textures(descriptor);
+
+    auto m = descriptor.m;
+	GLint col_attr = m_locs.col_attr;
+
+	const geometry_buffer &gbuf = get_geometry_buffer(m->get_geometry());
+
+	static GLuint vao = -1;
+	if (vao == -1) glGenVertexArrays(1, &vao);
+
+	glBindVertexArray(vao);
+
+	//------- Shared geometry --------//
+	bind_geometry(gbuf);
+
+	//------- Per instance colors --------//
+	if (col_attr != -1) {
+		if (m->m_colors.size() == gbuf.vert_num && gbuf.vert_num > 0) {
+			glBindBuffer(GL_ARRAY_BUFFER, get_color_buffer(m).vbo);
+			glVertexAttribPointer(col_attr, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+			glEnableVertexAttribArray(col_attr);
+		} else {
+			glDisableVertexAttribArray(col_attr);
+		}
+	}
+
+	glUseProgram(m_program);
+	set_pass_uniforms(params);
+
+	if (m_locs.instanced != -1) {
+		glUniform1i(m_locs.instanced, 0);
+	}
+
+	/* Uniform blocks, shaders without them fall back to plain uniforms */
+	if (m_locs.object_block != GL_INVALID_INDEX) {
+		if (params.draw_id >= 0) {
+			uniform_buffers::instance()->bind_object(params.draw_id);
+		} else {
+			uniform_buffers::instance()->bind_object(m->m_world);
+		}
+	}
+
+	if (m_locs.pvm != -1 || m_locs.p != -1 || m_locs.v != -1 || m_locs.m != -1) {
+		mat4 p = params.cur_camera->GetP();
+		mat4 v = params.cur_camera->GetV();
+		mat4 pvm = p * v * m->m_world;
+		if (m_locs.pvm != -1)
+			glUniformMatrix4fv(m_locs.pvm, 1, false, glm::value_ptr(pvm));
+
+		if (m_locs.p != -1)
+			glUniformMatrix4fv(m_locs.p, 1, false, glm::value_ptr(p));
+
+		if (m_locs.v != -1)
+			glUniformMatrix4fv(m_locs.v, 1, false, glm::value_ptr(v));
+
+		if (m_locs.m != -1)
+			glUniformMatrix4fv(m_locs.m, 1, false, glm::value_ptr(m->m_world));
+	}
+
+	glBindVertexArray(vao);
+	glDrawArrays(ogl_draw_type(descriptor.type), 0, (GLsizei)gbuf.vert_num);
+	glBindVertexArray(0);
+}
+
+/* Per instance vertex attributes, see inst_world/inst_normal_mat in template_vs.glsl */
+struct instance_attribs {
+	glm::mat4 world;
+	glm::vec3 normal_mat[3];
+	glm::vec3 color;
+};
+static_assert(sizeof(instance_attribs) == 112, "instance_attribs should be tightly packed");
+
+static void fill_instances(const std::vector<glm::mat4> &worlds, const std::vector<glm::vec3> &colors, instance_attribs *dst) {
+#pragma omp parallel for if(worlds.size() > 1024)
+	for (int i = 0; i < (int)worlds.size(); ++i) {
+		mat3 normal_mat = glm::transpose(glm::inverse(mat3(worlds[i])));
+		instance_attribs &inst = dst[i];
+		inst.world = worlds[i];
+		for (int c = 0; c < 3; ++c) {
+			inst.normal_mat[c] = normal_mat[c];
+		}
+		inst.color = i < colors.size() ? colors[i] : vec3(0.0f);
+	}
+}
+
+/* Instance attributes of the bound VAO from the bound GL_ARRAY_BUFFER, starting at base_instance */
+void shader::bind_instance_attributes(size_t base_instance) {
+	const GLsizei stride = sizeof(instance_attribs);
+	size_t base = base_instance * stride;
+	for (int c = 0; c < 4; ++c) {
+		GLuint loc = m_locs.inst_world + c;
+		glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + offsetof(instance_attribs, world) + c * sizeof(vec4)));
+		glVertexAttribDivisor(loc, 1);
+		glEnableVertexAttribArray(loc);
+	}
+
+	if (m_locs.inst_normal_mat != -1) {
+		for (int c = 0; c < 3; ++c) {
+			GLuint loc = m_locs.inst_normal_mat + c;
+			glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + offsetof(instance_attribs, normal_mat) + c * sizeof(vec3)));
+			glVertexAttribDivisor(loc, 1);
+			glEnableVertexAttribArray(loc);
+		}
+	}
+
+	if (m_locs.col_attr != -1) {
+		glVertexAttribPointer(m_locs.col_attr, 3, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(base + offsetof(instance_attribs, color)));
+		glVertexAttribDivisor(m_locs.col_attr, 1);
+		glEnableVertexAttribArray(m_locs.col_attr);
+	}
+}
+
+void shader::draw_instanced(const Mesh_Descriptor &descriptor, 
+							const std::vector<glm::mat4> &worlds, 
+							const std::vector<glm::vec3> &colors, 
+							rendering_params& params) {
+	if (descriptor.m == nullptr || worlds.empty()) {
+		return;
+	}
+
+	if (!supports_instancing()) {
+		WARN("Shader has no instance attributes, draw {} instances one by one", worlds.size());
+		auto m = descriptor.m;
+		mat4 old_world = m->m_world;
+		int old_draw_id = params.draw_id;
+		params.draw_id = -1;
+		for (size_t i = 0; i < worlds.size(); ++i) {
+			m->m_world = worlds[i];
+			draw_mesh(descriptor, params);
+		}
+		m->m_world = old_world;
+		params.draw_id = old_draw_id;
+		return;
+	}
+
+	bind_textures(descriptor);
+	const geometry_buffer &gbuf = get_geometry_buffer(descriptor.m->get_geometry());
+
+	static GLuint vao = -1, instance_vbo = -1;
+	static std::vector<instance_attribs> staging;
+	if (vao == -1) glGenVertexArrays(1, &vao);
+	if (instance_vbo == -1) glGenBuffers(1, &instance_vbo);
+
+	staging.resize(worlds.size());
+	fill_instances(worlds, colors, staging.data());
 
 	glBindVertexArray(vao);
-	glDrawArrays(ogl_draw_type, 0, (GLsizei)m->m_verts.size());
+	bind_geometry(gbuf);
+
+	/* Orphan then fill, the previous group may still be in flight */
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, staging.size() * sizeof(instance_attribs), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, staging.size() * sizeof(instance_attribs), staging.data());
+
+	bind_instance_attributes(0);
+
+	glUseProgram(m_program);
+	set_pass_uniforms(params);
+	glUniform1i(m_locs.instanced, 1);
+
+	/* object_block is unused by instanced draws but still needs a buffer bound */
+	if (m_locs.object_block != GL_INVALID_INDEX) {
+		uniform_buffers::instance()->bind_object(descriptor.m->m_world);
+	}
+
+	glDrawArraysInstanced(ogl_draw_type(descriptor.type), 0, (GLsizei)gbuf.vert_num, (GLsizei)worlds.size());
 	glBindVertexArray(0);
 }
 
+/* Layout of glMultiDrawArraysIndirect commands */
+struct draw_arrays_command {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first;
+	GLuint base_instance;
+};
+
+size_t shader::draw_indirect(const std::vector<instance_group> &groups, rendering_params& params) {
+	if (groups.empty()) {
+		return 0;
+	}
+
+	if (!supports_instancing()) {
+		for (auto &g:groups) {
+			draw_instanced(*g.desc, g.worlds, g.colors, params);
+		}
+		return groups.size();
+	}
+
+	/* Commands are sorted by draw type so each type is one contiguous multi draw */
+	const draw_type types[3] = {draw_type::triangle, draw_type::line_segments, draw_type::points};
+	static std::vector<draw_arrays_command> commands;
+	static std::vector<instance_attribs> staging;
+	commands.clear();
+
+	size_t instance_num = 0;
+	for (auto &g:groups) {
+		instance_num += g.worlds.size();
+	}
+	staging.resize(instance_num);
+
+	size_t type_begin[4] = {0, 0, 0, 0};
+	size_t base_instance = 0;
+	vertex_arena *arena = vertex_arena::instance();
+	for (int ti = 0; ti < 3; ++ti) {
+		type_begin[ti] = commands.size();
+		for (auto &g:groups) {
+			if (g.desc->type != types[ti] || g.worlds.empty()) {
+				continue;
+			}
+
+			const arena_range &range = arena->get_range(g.desc->m->get_geometry());
+			if (range.count == 0) {
+				continue;
+			}
+
+			fill_instances(g.worlds, g.colors, staging.data() + base_instance);
+			commands.push_back({(GLuint)range.count, (GLuint)g.worlds.size(), (GLuint)range.first, (GLuint)base_instance});
+			base_instance += g.worlds.size();
+		}
+	}
+	type_begin[3] = commands.size();
+	if (commands.empty()) {
+		return 0;
+	}
+
+	static GLuint vao = -1, instance_vbo = -1, indirect_buffer = -1;
+	if (vao == -1) glGenVertexArrays(1, &vao);
+	if (instance_vbo == -1) glGenBuffers(1, &instance_vbo);
+
+	glBindVertexArray(vao);
+	arena->bind_attributes(m_locs.pos_attr, m_locs.norm_attr, m_locs.uv_attr);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, base_instance * sizeof(instance_attribs), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, base_instance * sizeof(instance_attribs), staging.data());
+	bind_instance_attributes(0);
+
+	glUseProgram(m_program);
+	set_pass_uniforms(params);
+	glUniform1i(m_locs.instanced, 1);
+	if (m_locs.object_block != GL_INVALID_INDEX) {
+		uniform_buffers::instance()->bind_object(glm::mat4(1.0f));
+	}
+
+	size_t draw_calls = 0;
+	const ogl_extensions &ext = get_ogl_extensions();
+	if (ext.multi_draw_arrays_indirect) {
+		if (indirect_buffer == -1) glGenBuffers(1, &indirect_buffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(draw_arrays_command), commands.data(), GL_STREAM_DRAW);
+		for (int ti = 0; ti < 3; ++ti) {
+			GLsizei num = (GLsizei)(type_begin[ti + 1] - type_begin[ti]);
+			if (num > 0) {
+				ext.multi_draw_arrays_indirect(ogl_draw_type(types[ti]), BUFFER_OFFSET(type_begin[ti] * sizeof(draw_arrays_command)), num, 0);
+				++draw_calls;
+			}
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+		for (int ti = 0; ti < 3; ++ti) {
+			for (size_t ci = type_begin[ti]; ci < type_begin[ti + 1]; ++ci) {
+				const draw_arrays_command &cmd = commands[ci];
+				if (ext.draw_arrays_instanced_base_instance) {
+					ext.draw_arrays_instanced_base_instance(ogl_draw_type(types[ti]), cmd.first, cmd.count, cmd.instance_count, cmd.base_instance);
+				} else {
+					bind_instance_attributes(cmd.base_instance);
+					glDrawArraysInstanced(ogl_draw_type(types[ti]), cmd.first, cmd.count, cmd.instance_count);
+				}
+				++draw_calls;
+			}
+		}
+	}
+	glBindVertexArray(0);
+	return draw_calls;
+}
+
+const geometry_buffer& shader::get_geometry_buffer(const std::shared_ptr<mesh_geometry> &geometry) {
+	geometry_buffer &buf = m_geometry_buffers[geometry.get()];
+
+	/* A new geometry may reuse the address of a released one */
+	bool stale = buf.owner.lock() != geometry;
+	if (!stale && buf.version == geometry->version && buf.vert_num == geometry->verts.size()) {
+		return buf;
+	}
+
+	if (buf.vbo == -1) glGenBuffers(1, &buf.vbo);
+
+	size_t n = geometry->verts.size();
+	buf.owner       = geometry;
+	buf.version     = geometry->version;
+	buf.vert_num    = n;
+	buf.has_norm    = n > 0 && geometry->norms.size() == n;
+	buf.has_uv      = n > 0 && geometry->uvs.size() == n;
+	buf.norm_offset = n * sizeof(vec3);
+	buf.uv_offset   = buf.norm_offset + (buf.has_norm ? n * sizeof(vec3) : 0);
+
+	size_t buffer_size = buf.uv_offset + (buf.has_uv ? n * sizeof(vec2) : 0);
+	glBindBuffer(GL_ARRAY_BUFFER, buf.vbo);
+	glBufferData(GL_ARRAY_BUFFER, buffer_size, 0, GL_STATIC_DRAW);
+	if (n > 0) {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(vec3), &geometry->verts[0]);
+	}
+	if (buf.has_norm) {
+		glBufferSubData(GL_ARRAY_BUFFER, buf.norm_offset, n * sizeof(vec3), &geometry->norms[0]);
+	}
+	if (buf.has_uv) {
+		glBufferSubData(GL_ARRAY_BUFFER, buf.uv_offset, n * sizeof(vec2), &geometry->uvs[0]);
+	}
+	return buf;
+}
+
+const color_buffer& shader::get_color_buffer(const std::shared_ptr<mesh> &m) {
+	color_buffer &buf = m_color_buffers[m.get()];
+
+	/* A new mesh may reuse the address of a released one */
+	bool stale = buf.owner.lock() != m;
+	if (!stale && buf.version == m->get_color_version() && buf.count == m->m_colors.size()) {
+		return buf;
+	}
+
+	if (buf.vbo == -1) glGenBuffers(1, &buf.vbo);
+
+	buf.owner   = m;
+	buf.version = m->get_color_version();
+	buf.count   = m->m_colors.size();
+
+	glBindBuffer(GL_ARRAY_BUFFER, buf.vbo);
+	glBufferData(GL_ARRAY_BUFFER, buf.count * sizeof(vec3), buf.count ? &m->m_colors[0] : 0, GL_STATIC_DRAW);
+	return buf;
+}
+
+void shader::upload_frame(const rendering_params &params) {
+	frame_uniforms frame;
+	frame.P          = params.cur_camera->GetP();
+	frame.V          = params.cur_camera->GetV();
+	frame.PV         = frame.P * frame.V;
+	frame.light_pv   = glm::mat4(1.0f);
+	frame.light_pos  = glm::vec4(0.0f);
+	frame.camera_pos = glm::vec4(params.cur_camera->get_pos(), 1.0f);
+
+	if (params.light_camera) {
+		frame.light_pv = params.light_camera->GetP() * params.light_camera->GetV();
+	}
+
+	//#todo_multiple_lights
+	if (!params.lights.empty()) {
+		frame.light_pos = glm::vec4(params.lights[0], 1.0f);
+	}
+
+	uniform_buffers::instance()->set_frame(frame);
+}
+
+void shader::collect_geometry_buffers() {
+	for (auto it = m_geometry_buffers.begin(); it != m_geometry_buffers.end();) {
+		if (it->second.owner.expired()) {
+			glDeleteBuffers(1, &it->second.vbo);
+			it = m_geometry_buffers.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	for (auto it = m_color_buffers.begin(); it != m_color_buffers.end();) {
+		if (it->second.owner.expired()) {
+			glDeleteBuffers(1, &it->second.vbo);
+			it = m_color_buffers.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
 
 GLuint shader::init_compute_shader() {
 	bool error = false;
@@ -5,7 +5,10 @@
 
 #include "mesh.h"
 #include "ppc.h"
+#include "uniform_buffer.h"
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 enum class draw_type {
 	triangle,
@@ -27,7 +30,11 @@ struct rendering_params {
     std::vector<glm::vec3> lights;
     GLuint sm_texture;
 
-	rendering_params():frame(0) {
+	/* Set by the renderer when the uniform blocks are already written for this pass */
+	bool frame_ready = false;
+	int draw_id = -1;	// object slot in uniform_buffers, -1 for a one-off slot
+
+	rendering_params():frame(0), sm_texture(-1) {
 	}
 };
 
@@ -47,6 +54,41 @@ struct Mesh_Descriptor {
                     draw_type type):m(m), texs(texs), type(type) {}
 };
 
+/* Copies of one geometry drawn together, colors are per copy */
+struct instance_group {
+	std::shared_ptr<Mesh_Descriptor> desc;
+	std::vector<glm::mat4> worlds;
+	std::vector<glm::vec3> colors;
+};
+
+/* GPU copy of a mesh_geometry, shared by every shader and mesh instance */
+struct geometry_buffer {
+	GLuint vbo = -1;
+	uint64_t version = 0;
+	size_t vert_num = 0;
+	size_t norm_offset = 0, uv_offset = 0;	// bytes
+	bool has_norm = false, has_uv = false;
+	std::weak_ptr<mesh_geometry> owner;
+};
+
+/* GPU copy of the per instance colors of a mesh, keyed by its color version */
+struct color_buffer {
+	GLuint vbo = -1;
+	uint64_t version = 0;
+	size_t count = 0;
+	std::weak_ptr<mesh> owner;
+};
+
+/* Locations of the inputs draw_mesh feeds, -1 if the program does not use them */
+struct shader_locations {
+	GLint pos_attr = -1, norm_attr = -1, col_attr = -1, uv_attr = -1;
+	GLint pvm = -1, p = -1, v = -1, m = -1;
+	GLint light_pos = -1, light_pv = -1;
+	GLint shadow_map = -1, draw_shadow = -1;
+	GLint instanced = -1, inst_world = -1, inst_normal_mat = -1;	// instanced draws
+	GLuint frame_block = GL_INVALID_INDEX, object_block = GL_INVALID_INDEX;
+};
+
 class shader  {
 public:
 	shader(const char* computeShaderFile);
@@ -56,18 +98,63 @@ public:
 	bool reload_shader();
 	virtual void draw_mesh(const Mesh_Descriptor &descriptor, rendering_params& params);
 
+	/* One instanced draw of descriptor's geometry per world matrix, colors are per instance */
+	void draw_instanced(const Mesh_Descriptor &descriptor, 
+						const std::vector<glm::mat4> &worlds, 
+						const std::vector<glm::vec3> &colors, 
+						rendering_params& params);
+
+	/* All groups from the shared vertex arena, one glMultiDrawArraysIndirect per draw type.
+	 * Falls back to one instanced draw per group without GL 4.3 / ARB_multi_draw_indirect.
+	 * Returns the number of GL draw calls issued. */
+	size_t draw_indirect(const std::vector<instance_group> &groups, rendering_params& params);
+	bool supports_instancing() const { return m_locs.inst_world != -1 && m_locs.instanced != -1; }
+
 	GLuint get_program() { return m_program; }
 	GLuint get_shader_program() { return m_program; }
 	void bind() {	glUseProgram(m_program);	}
+
+	/* Active uniforms/attributes, reflected after every link. -1 if inactive */
+	GLint uniform_location(const std::string &name) const;
+	GLint attrib_location(const std::string &name) const;
+	const shader_locations& locations() const { return m_locs; }
+
+	/* Typed setters for the bound program, inactive uniforms are no-ops */
+	void set_int(const std::string &name, int v) const;
+	void set_float(const std::string &name, float v) const;
+	void set_vec2(const std::string &name, const glm::vec2 &v) const;
+	void set_vec3(const std::string &name, const glm::vec3 &v) const;
+	void set_vec4(const std::string &name, const glm::vec4 &v) const;
+	void set_mat3(const std::string &name, const glm::mat3 &v) const;
+	void set_mat4(const std::string &name, const glm::mat4 &v) const;
+
+	/* Geometry VBOs, uploaded again only when the geometry version changes */
+	static const geometry_buffer& get_geometry_buffer(const std::shared_ptr<mesh_geometry> &geometry);
+	static const color_buffer& get_color_buffer(const std::shared_ptr<mesh> &m);
+	static void collect_geometry_buffers();	// free VBOs of released geometry and meshes
+
+	/* Fill the frame block from the camera and lights of params */
+	static void upload_frame(const rendering_params &params);
 	
 private:
 	GLuint init_template_shader();
 	GLuint init_compute_shader();
 	GLuint init_geometry_shader();
 	void init_textures();
+	void reflect();
+
+	void bind_textures(const Mesh_Descriptor &descriptor);
+	void bind_geometry(const geometry_buffer &gbuf);
+	void set_pass_uniforms(rendering_params& params);
+	void bind_instance_attributes(size_t base_instance);
+
+	static std::unordered_map<const mesh_geometry*, geometry_buffer> m_geometry_buffers;
+	static std::unordered_map<const mesh*, color_buffer> m_color_buffers;
 
 protected:
-	GLuint m_program;
+	GLuint m_program = -1;
+	std::unordered_map<std::string, GLint> m_uniforms, m_attribs;
+	shader_locations m_locs;
 	std::string m_vs, m_fs, m_gs, m_cs;
 	shader_type m_type;
     std::vector<GLuint> m_texids; 
@@ -0,0 +1,103 @@
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "uniform_buffer.h"
+
+uniform_buffers* uniform_buffers::m_instance = nullptr;
+
+uniform_buffers* uniform_buffers::instance() {
+    if (m_instance == nullptr) {
+        m_instance = new uniform_buffers();
+    }
+    return m_instance;
+}
+
+uniform_buffers::uniform_buffers() {
+    memset(&m_frame, 0, sizeof(m_frame));
+}
+
+void uniform_buffers::init() {
+    if (m_frame_ubo != -1) {
+        return;
+    }
+
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+    m_stride = (sizeof(object_uniforms) + alignment - 1) / alignment * alignment;
+
+    glGenBuffers(1, &m_frame_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frame_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_uniforms), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &m_single_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_single_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(object_uniforms), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &m_object_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void uniform_buffers::set_frame(const frame_uniforms &frame) {
+    init();
+
+    m_frame = frame;
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frame_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame_uniforms), &m_frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, frame_block_binding, m_frame_ubo);
+}
+
+static object_uniforms make_object(const glm::mat4 &pv, const glm::mat4 &world) {
+    object_uniforms ret;
+    ret.M          = world;
+    ret.PVM        = pv * world;
+    ret.normal_mat = glm::inverseTranspose(world);
+    return ret;
+}
+
+void uniform_buffers::set_objects(const std::vector<glm::mat4> &worlds) {
+    init();
+
+    m_object_num = worlds.size();
+    size_t bytes = m_stride * m_object_num;
+    if (bytes == 0) {
+        return;
+    }
+
+    if (m_staging.size() < bytes) {
+        m_staging.resize(bytes);
+    }
+
+    const glm::mat4 pv = m_frame.PV;
+    char *staging = m_staging.data();
+    size_t stride = m_stride;
+#pragma omp parallel for if(worlds.size() > 1024)
+    for (int i = 0; i < (int)worlds.size(); ++i) {
+        object_uniforms obj = make_object(pv, worlds[i]);
+        memcpy(staging + i * stride, &obj, sizeof(obj));
+    }
+
+    /* Orphan the old storage so the driver does not wait on last frame's draws */
+    glBindBuffer(GL_UNIFORM_BUFFER, m_object_ubo);
+    if (bytes > m_capacity) {
+        m_capacity = bytes;
+    }
+    glBufferData(GL_UNIFORM_BUFFER, m_capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, bytes, staging);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void uniform_buffers::bind_object(size_t i) {
+    FAIL(i >= m_object_num, "Object slot {} out of range({})", i, m_object_num);
+    glBindBufferRange(GL_UNIFORM_BUFFER, object_block_binding, m_object_ubo, i * m_stride, sizeof(object_uniforms));
+}
+
+void uniform_buffers::bind_object(const glm::mat4 &world) {
+    init();
+
+    object_uniforms obj = make_object(m_frame.PV, world);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_single_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(obj), &obj);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, object_block_binding, m_single_ubo);
+}
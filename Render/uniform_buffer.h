@@ -0,0 +1,62 @@
+/* std140 uniform blocks shared by all mesh shaders
+ *
+ *  frame_block  (binding 0): camera and light data, written once per pass
+ *  object_block (binding 1): model, PVM and normal matrices, one slot per draw
+ *
+ *  All object slots of a pass are uploaded together, a draw then only binds
+ *  its slot with glBindBufferRange. The GLSL side is declared in the Shaders/..._vs.glsl files.
+ * */
+#pragma once
+#include <common.h>
+
+const GLuint frame_block_binding  = 0;
+const GLuint object_block_binding = 1;
+
+struct frame_uniforms {
+    glm::mat4 P;
+    glm::mat4 V;
+    glm::mat4 PV;
+    glm::mat4 light_pv;
+    glm::vec4 light_pos;    // w = 0 if the scene has no light
+    glm::vec4 camera_pos;
+};
+static_assert(sizeof(frame_uniforms) == 288, "frame_uniforms should follow std140");
+
+struct object_uniforms {
+    glm::mat4 M;
+    glm::mat4 PVM;
+    glm::mat4 normal_mat;   // transpose(inverse(M)), mat4 to avoid std140 mat3 padding
+};
+static_assert(sizeof(object_uniforms) == 192, "object_uniforms should follow std140");
+
+class uniform_buffers {
+public:
+    static uniform_buffers* instance();
+
+    /* Writes and binds the frame block */
+    void set_frame(const frame_uniforms &frame);
+    const frame_uniforms& get_frame() const { return m_frame; }
+
+    /* Uploads one slot per world matrix using the current frame's PV */
+    void set_objects(const std::vector<glm::mat4> &worlds);
+    size_t object_num() const { return m_object_num; }
+
+    /* Binds slot i of the last set_objects */
+    void bind_object(size_t i);
+
+    /* Binds a one-off slot for draws outside a batched pass */
+    void bind_object(const glm::mat4 &world);
+
+private:
+    uniform_buffers();
+    void init();
+
+    static uniform_buffers *m_instance;
+
+    GLuint m_frame_ubo = -1, m_object_ubo = -1, m_single_ubo = -1;
+    size_t m_stride = 0;            // object slot size rounded up to the offset alignment
+    size_t m_object_num = 0;
+    size_t m_capacity = 0;          // bytes
+    frame_uniforms m_frame;
+    std::vector<char> m_staging;
+};
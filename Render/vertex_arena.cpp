@@ -0,0 +1,176 @@
+#include "vertex_arena.h"
+
+#define BUFFER_OFFSET(i) ((char*)NULL + (i))
+
+static const size_t min_arena_vertices = 1 << 16;
+static const size_t arena_vertex_bytes = sizeof(vec3) * 2 + sizeof(vec2);
+
+vertex_arena* vertex_arena::m_instance = nullptr;
+
+vertex_arena* vertex_arena::instance() {
+    if (m_instance == nullptr) {
+        m_instance = new vertex_arena();
+    }
+    return m_instance;
+}
+
+const arena_range& vertex_arena::get_range(const std::shared_ptr<mesh_geometry> &geometry) {
+    arena_range &range = m_ranges[geometry.get()];
+
+    /* A new geometry may reuse the address of a released one */
+    bool stale = range.owner.lock() != geometry;
+    GLsizei n = (GLsizei)geometry->verts.size();
+    if (!stale && range.version == geometry->version && range.count == n) {
+        return range;
+    }
+
+    if (stale || range.count != n) {
+        if (range.count > 0) {
+            release(range.first, range.count);
+        }
+        range.first = n > 0 ? allocate(n) : 0;
+        range.count = n;
+    }
+
+    range.owner   = geometry;
+    range.version = geometry->version;
+    if (n > 0) {
+        upload(*geometry, range);
+    }
+    return range;
+}
+
+void vertex_arena::collect() {
+    for (auto it = m_ranges.begin(); it != m_ranges.end();) {
+        if (it->second.owner.expired()) {
+            if (it->second.count > 0) {
+                release(it->second.first, it->second.count);
+            }
+            it = m_ranges.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void vertex_arena::bind_attributes(GLint pos_attr, GLint norm_attr, GLint uv_attr) {
+    if (m_vbo == -1) {
+        grow(min_arena_vertices);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (pos_attr != -1) {
+        glVertexAttribPointer(pos_attr, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+        glEnableVertexAttribArray(pos_attr);
+    }
+
+    if (norm_attr != -1) {
+        glVertexAttribPointer(norm_attr, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(norm_offset()));
+        glEnableVertexAttribArray(norm_attr);
+    }
+
+    if (uv_attr != -1) {
+        glVertexAttribPointer(uv_attr, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(uv_offset()));
+        glEnableVertexAttribArray(uv_attr);
+    }
+}
+
+/* First fit over the free list, grows the buffer if nothing fits */
+GLint vertex_arena::allocate(GLsizei n) {
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        if (it->second < n) {
+            continue;
+        }
+
+        GLint first = it->first;
+        GLsizei rest = it->second - n;
+        m_free.erase(it);
+        if (rest > 0) {
+            m_free[first + n] = rest;
+        }
+        m_used += n;
+        return first;
+    }
+
+    grow(std::max(m_capacity * 2, m_capacity + n));
+    return allocate(n);
+}
+
+void vertex_arena::release(GLint first, GLsizei n) {
+    m_used -= n;
+    add_free(first, n);
+}
+
+void vertex_arena::add_free(GLint first, GLsizei n) {
+    auto it = m_free.emplace(first, n).first;
+
+    /* Merge with the next and the previous free block */
+    auto next = std::next(it);
+    if (next != m_free.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        m_free.erase(next);
+    }
+
+    if (it != m_free.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            m_free.erase(it);
+        }
+    }
+}
+
+void vertex_arena::grow(size_t min_capacity) {
+    size_t new_capacity = std::max(min_capacity, min_arena_vertices);
+    if (new_capacity <= m_capacity) {
+        return;
+    }
+
+    GLuint new_vbo;
+    glGenBuffers(1, &new_vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_capacity * arena_vertex_bytes, nullptr, GL_STATIC_DRAW);
+
+    /* Each region moves to its offset in the larger buffer */
+    if (m_vbo != -1) {
+        size_t old_norm = norm_offset(), old_uv = uv_offset();
+        size_t new_norm = new_capacity * sizeof(vec3), new_uv = new_capacity * sizeof(vec3) * 2;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, m_capacity * sizeof(vec3));
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, old_norm, new_norm, m_capacity * sizeof(vec3));
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, old_uv, new_uv, m_capacity * sizeof(vec2));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &m_vbo);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    INFO("Vertex arena grows {} -> {} vertices", m_capacity, new_capacity);
+
+    add_free((GLint)m_capacity, (GLsizei)(new_capacity - m_capacity));
+    m_capacity = new_capacity;
+    m_vbo = new_vbo;
+}
+
+void vertex_arena::upload(const mesh_geometry &geometry, const arena_range &range) {
+    size_t n = range.count;
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(vec3), n * sizeof(vec3), &geometry.verts[0]);
+
+    std::vector<vec3> zero3;
+    const vec3 *norms = geometry.norms.size() == n ? &geometry.norms[0] : nullptr;
+    if (norms == nullptr) {
+        zero3.resize(n, vec3(0.0f));
+        norms = zero3.data();
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, norm_offset() + range.first * sizeof(vec3), n * sizeof(vec3), norms);
+
+    std::vector<vec2> zero2;
+    const vec2 *uvs = geometry.uvs.size() == n ? &geometry.uvs[0] : nullptr;
+    if (uvs == nullptr) {
+        zero2.resize(n, vec2(0.0f));
+        uvs = zero2.data();
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, uv_offset() + range.first * sizeof(vec2), n * sizeof(vec2), uvs);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,60 @@
+/* Shared vertex arena for batched draws
+ *
+ *  Every geometry drawn through the arena gets a vertex range of one VBO.
+ *  The buffer is split into [positions | normals | uvs], each sized by the
+ *  capacity, so vertex i of a geometry sits at first + i in every region and
+ *  one VAO serves all meshes. Missing normals/uvs are filled with zeros.
+ *
+ *  Ranges are reused when the geometry keeps its vertex count, freed ranges
+ *  are coalesced, and the buffer doubles (copied on the GPU) when full.
+ * */
+#pragma once
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#include "mesh.h"
+
+struct arena_range {
+    GLint first = 0;
+    GLsizei count = 0;
+    uint64_t version = 0;
+    std::weak_ptr<mesh_geometry> owner;
+};
+
+class vertex_arena {
+public:
+    static vertex_arena* instance();
+
+    /* Uploads the geometry if it is new or changed */
+    const arena_range& get_range(const std::shared_ptr<mesh_geometry> &geometry);
+
+    /* Release ranges of geometry that no longer exists */
+    void collect();
+
+    /* Point the attributes of the bound VAO at the arena, -1 to skip.
+     * Call after the get_range calls of a frame, those may grow the buffer. */
+    void bind_attributes(GLint pos_attr, GLint norm_attr, GLint uv_attr);
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used; }
+
+private:
+    vertex_arena() = default;
+
+    GLint allocate(GLsizei n);
+    void release(GLint first, GLsizei n);
+    void add_free(GLint first, GLsizei n);
+    void grow(size_t min_capacity);
+    void upload(const mesh_geometry &geometry, const arena_range &range);
+
+    size_t norm_offset() const { return m_capacity * sizeof(vec3); }
+    size_t uv_offset() const { return m_capacity * sizeof(vec3) * 2; }
+
+    static vertex_arena *m_instance;
+
+    GLuint m_vbo = -1;
+    size_t m_capacity = 0, m_used = 0;      // vertices
+    std::map<GLint, GLsizei> m_free;        // first -> count
+    std::unordered_map<const mesh_geometry*, arena_range> m_ranges;
+};
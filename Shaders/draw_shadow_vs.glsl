@@ -2,12 +2,20 @@
 
 layout(location=0) in vec3 pos_attr;
 
-uniform mat4 PVM;
-uniform mat4 P;
-uniform mat4 V;
-uniform mat4 M;
+layout(std140) uniform frame_block {
+    mat4 P;
+    mat4 V;
+    mat4 PV;
+    mat4 light_pv;
+    vec4 light_pos;
+    vec4 camera_pos;
+};
 
-uniform mat4 light_pv;
+layout(std140) uniform object_block {
+    mat4 M;
+    mat4 PVM;
+    mat4 normal_mat;
+};
 
 out vec4 vs_light_space_pos; // light space position
 
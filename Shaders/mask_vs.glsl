@@ -5,10 +5,20 @@ layout(location=1) in vec3 norm_attr;
 layout(location=2) in vec3 col_attr;
 layout(location=3) in vec2 uv_attr;
 
-uniform mat4 PVM;
-uniform mat4 P;
-uniform mat4 V;
-uniform mat4 M;
+layout(std140) uniform frame_block {
+    mat4 P;
+    mat4 V;
+    mat4 PV;
+    mat4 light_pv;
+    vec4 light_pos;
+    vec4 camera_pos;
+};
+
+layout(std140) uniform object_block {
+    mat4 M;
+    mat4 PVM;
+    mat4 normal_mat;
+};
 
 out vec3 vs_pos;  // world space position
 out vec3 vs_color;
@@ -21,6 +31,6 @@ void main(){
     // pass values to next step
     vs_pos = vec3(M * vec4(pos_attr, 1.0));
     vs_color = col_attr;
-    vs_norm = normalize((transpose(inverse(M)) * vec4(norm_attr, 0.0f)).xyz);
+    vs_norm = normalize(mat3(normal_mat) * norm_attr);
     vs_uvs = uv_attr;    
 }
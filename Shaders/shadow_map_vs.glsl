@@ -2,7 +2,20 @@
 
 layout(location=0) in vec3 pos_attr;
 
-uniform mat4 PVM;
+layout(std140) uniform frame_block {
+    mat4 P;
+    mat4 V;
+    mat4 PV;
+    mat4 light_pv;
+    vec4 light_pos;
+    vec4 camera_pos;
+};
+
+layout(std140) uniform object_block {
+    mat4 M;
+    mat4 PVM;
+    mat4 normal_mat;
+};
 
 void main(){
     gl_Position = PVM * vec4(pos_attr,1.0f);
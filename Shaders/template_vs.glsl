@@ -4,12 +4,25 @@ layout(location=0) in vec3 pos_attr;
 layout(location=1) in vec3 norm_attr;
 layout(location=2) in vec3 col_attr;
 layout(location=3) in vec2 uv_attr;
+layout(location=4) in mat4 inst_world;       // instanced draws only
+layout(location=8) in mat3 inst_normal_mat;
 
-uniform mat4 PVM;
-uniform mat4 P;
-uniform mat4 V;
-uniform mat4 M;
-uniform mat4 light_pv;
+layout(std140) uniform frame_block {
+    mat4 P;
+    mat4 V;
+    mat4 PV;
+    mat4 light_pv;
+    vec4 light_pos;
+    vec4 camera_pos;
+};
+
+layout(std140) uniform object_block {
+    mat4 M;
+    mat4 PVM;
+    mat4 normal_mat;
+};
+
+uniform int instanced;
 
 out vec3 vs_pos;  // world space position
 out vec3 vs_color;
@@ -18,14 +31,20 @@ out vec2 vs_uvs;
 out vec4 vs_light_space_pos; // light space position
 
 void main(){
-    gl_Position = PVM * vec4(pos_attr,1.0f);
+    mat4 world = M;
+    mat3 world_normal = mat3(normal_mat);
+    if (instanced > 0) {
+        world = inst_world;
+        world_normal = inst_normal_mat;
+    }
 
     // pass values to next step
-    vec4 tmp = M * vec4(pos_attr, 1.0);
+    vec4 tmp = world * vec4(pos_attr, 1.0);
+    gl_Position = PV * tmp;
     vs_pos = vec3(tmp/tmp.w);
     vs_color = col_attr;
-    vs_norm = normalize((transpose(inverse(M)) * vec4(norm_attr, 0.0f)).xyz);
+    vs_norm = normalize(world_normal * norm_attr);
     vs_uvs = uv_attr;    
 
-    vs_light_space_pos = light_pv * M * vec4(pos_attr,1.0f);
+    vs_light_space_pos = light_pv * tmp;
 }
@@ -170,23 +170,31 @@ void otb_window::show() {
 }
 
 void otb_window::save_framebuffer(const std::string output_file) {
-    unsigned int *pixels;
     int w = width(), h = height();
-    pixels = new unsigned int[w * h * 4];
-    for (int i = 0; i < (w * h * 4); i++) {
-        pixels[i] = 0;
+    std::vector<unsigned char> pixels((size_t)w * h * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    // filp pixels, one row pair per iteration
+    size_t row = (size_t)w * 4;
+#pragma omp parallel for
+    for (int j = 0; j < h / 2; ++j) {
+        std::swap_ranges(pixels.begin() + j * row,
+                         pixels.begin() + (j + 1) * row,
+                         pixels.begin() + (h - 1 - j) * row);
     }
 
-    glReadPixels(0, 0, width(), height(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    save_image(output_file, reinterpret_cast<unsigned int*>(pixels.data()), w, h, 4);
+}
 
-    // filp pixels
-    for (int j = 0; j < h / 2; ++j)
-        for (int i = 0; i < w; ++i) {
-            std::swap(pixels[w * j + i], pixels[w * (h - 1 - j) + i]);
-        }
+void otb_window::read_framebuffer(Image &out) {
+    int w = width(), h = height();
+    std::vector<unsigned char> pixels((size_t)w * h * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 
-    save_image(output_file, pixels, w, h, 4);
-    delete[] pixels;
+    /* OpenGL rows are bottom-up, flip during the conversion */
+    out.from_unsigned_data(pixels.data(), w, h, true);
 }
 
 int otb_window::width() {
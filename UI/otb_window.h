@@ -36,6 +36,7 @@ public:
 	
 	void show();		// one thread one window
 	void save_framebuffer(const std::string output_file);
+	void read_framebuffer(Image &out);
 	int width();
 	int height();
 
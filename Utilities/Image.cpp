@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <cfloat>
 #include <common.h>
 #include <cstddef>
 #include <stdexcept>
 #include "Image.h"
 #include "Utils.h"
+#include "image_writer.h"
 
 Image::Image(int w, int h) {
     init(w, h);
@@ -149,36 +151,58 @@ size_t Image::get_ind(size_t i, size_t j, size_t w,size_t h) {
     return j * w + i;
 }
 
-std::vector<unsigned int> Image::to_unsigned_data() {
-    std::vector<unsigned int> ret(width() * height());
+void Image::u8_to_float(const unsigned char *src, float *dst, size_t n) {
+#pragma omp simd
+    for (size_t k = 0; k < n; ++k) {
+        dst[k] = src[k] / 255.0f;
+    }
+}
 
-    for(int i = 0; i < width(); ++i) for (int j = 0; j < height(); ++j) {
-        int ind = get_ind(i, j, width(), height());
-        ret[ind] = vec4_uint(glm::clamp(at(i, j), vec4(0.0f), vec4(1.0f)));
+void Image::float_to_u8(const float *src, unsigned char *dst, size_t n) {
+    /* Saturate to [0, 1] then truncate, same as vec4_uint on clamped input */
+#pragma omp simd
+    for (size_t k = 0; k < n; ++k) {
+        float v = std::min(std::max(src[k], 0.0f), 1.0f);
+        dst[k] = (unsigned char)(v * 255.0f);
     }
+}
 
+std::vector<unsigned int> Image::to_unsigned_data() const {
+    std::vector<unsigned int> ret(width() * height());
+    to_unsigned_data(reinterpret_cast<unsigned char*>(ret.data()));
     return ret;
 }
 
+void Image::to_unsigned_data(unsigned char *out) const {
+    const float *src = reinterpret_cast<const float*>(m_buffer.data());
+    size_t row = (size_t)m_w * 4;
+
+#pragma omp parallel for
+    for (int j = 0; j < m_h; ++j) {
+        float_to_u8(src + j * row, out + j * row, row);
+    }
+}
+
 void Image::clear(glm::vec4 c) {
     std::fill(m_buffer.begin(), m_buffer.end(), c);
 }
 
-void Image::from_unsigned_data(unsigned char *data, int w, int h) {
+void Image::from_unsigned_data(unsigned char *data, int w, int h, bool flip_y) {
     if (!data) {
         throw std::invalid_argument("Reading Image failed!");
         return;
     }
 
     set_dim(w, h);
-    m_buffer.resize(w * h);
-    for(int i = 0; i < w; ++i) for(int j = 0; j < h; ++j) {
-        long long ind = get_ind(i, j, w, h);
+    m_buffer.resize((size_t)w * h);
+
+    float *dst = reinterpret_cast<float*>(m_buffer.data());
+    size_t row = (size_t)w * 4;
 
-        m_buffer[ind] = vec4(data[4 * ind + 0]/255.0f,
-            data[4 * ind + 1]/255.0f,
-            data[4 * ind + 2]/255.0f,
-            data[4 * ind + 3]/255.0f);
+#pragma omp parallel for
+    for (int j = 0; j < h; ++j) {
+        int src_j = flip_y ? h - 1 - j : j;
+        u8_to_float(data + src_j * row, dst + j * row, row);
     }
 }
 
@@ -188,12 +212,7 @@ void Image::from_unsigned_data(unsigned int *data, int w, int h) {
         return;
     }
 
-    size_t num = w * h;
-    set_dim(w, h);
-    m_buffer.resize(num);
-    for(int i = 0; i < num; ++i) {
-        m_buffer[i] = uint_vec4(data[i]);
-    }
+    from_unsigned_data(reinterpret_cast<unsigned char*>(data), w, h);
 }
 
 Image Image::normalize(bool alpha) {
@@ -217,16 +236,7 @@ bool Image::save(const std::string fname, bool normalize) {
         return tmp.save(fname);
     }
 
-    std::string folder = purdue::get_file_dir(fname);
-    if (!folder.empty() && !purdue::file_exists(folder)) {
-        ERROR("Folder({}) is missing", folder);
-        return false;
-    }
-
-    std::vector<unsigned int> tmp = to_unsigned_data();
-
-    /* Note, only save to png currently */
-    return purdue::save_image(fname.c_str(), tmp.data(), m_w, m_h);
+    return write(fname);
 }
 
 bool Image::save(const std::string fname, bool normalize, bool alpha) {
@@ -235,18 +245,44 @@ bool Image::save(const std::string fname, bool normalize, bool alpha) {
         return tmp.save(fname);
     }
 
+    return write(fname);
+}
+
+bool Image::write(const std::string fname) const {
     std::string folder = purdue::get_file_dir(fname);
     if (!folder.empty() && !purdue::file_exists(folder)) {
         ERROR("Folder({}) is missing", folder);
         return false;
     }
 
+    /* Float formats skip the 8 bit conversion */
+    std::string ext = purdue::get_file_ext(fname);
+    if (ext == "npy") {
+        return save_npy(fname);
+    }
+    if (ext == "raw") {
+        return save_raw(fname);
+    }
+
     std::vector<unsigned int> tmp = to_unsigned_data();
 
-    /* Note, only save to png currently */
+    /* Note, other extensions are saved as png */
     return purdue::save_image(fname.c_str(), tmp.data(), m_w, m_h);
 }
 
+bool Image::save_npy(const std::string fname) const {
+    return purdue::save_npy(fname, reinterpret_cast<const float*>(m_buffer.data()), m_w, m_h, 4);
+}
+
+bool Image::save_raw(const std::string fname) const {
+    return purdue::save_raw(fname, reinterpret_cast<const float*>(m_buffer.data()), m_w, m_h, 4);
+}
+
+bool Image::save_tiles(const std::string fname, int tile_size, bool compress) const {
+    auto comp = compress ? purdue::tile_compression::zstd : purdue::tile_compression::none;
+    return purdue::save_float_tiles(fname, reinterpret_cast<const float*>(m_buffer.data()), m_w, m_h, 4, tile_size, comp);
+}
+
 bool Image::load(const std::string fname) {
     int c=0;
     std::vector<unsigned char> buf;
@@ -32,6 +32,11 @@ public:
     bool save(const std::string fname, bool normalize, bool alpha);
     bool load(const std::string fname);
 
+    /* Float dumps, no quantization. See image_writer.h for the layouts */
+    bool save_npy(const std::string fname) const;
+    bool save_raw(const std::string fname) const;
+    bool save_tiles(const std::string fname, int tile_size=64, bool compress=false) const;
+
     /* Low level IO */
     glm::vec3 get_rgb(int i, int j) const;
     float get_a(int i, int j) const;
@@ -40,15 +45,21 @@ public:
     bool set_a(int i, int j, float v);
 
     glm::vec4* data() { return m_buffer.data();}
+    const glm::vec4* data() const { return m_buffer.data();}
     glm::vec4& at(int i, int j);
     glm::vec4 get(int i, int j) const;
     std::vector<glm::vec4>& get_buffer() { return m_buffer; }
     void copy_buffer(int w, int h, std::vector<glm::vec4> &buffer); 
-    std::vector<unsigned int> to_unsigned_data();
+    std::vector<unsigned int> to_unsigned_data() const;
+    void to_unsigned_data(unsigned char *out) const;    /* out has w * h * 4 bytes */
     void from_unsigned_data(const std::vector<unsigned int> &data, int w, int h);
-    void from_unsigned_data(unsigned char *data, int w, int h);
+    void from_unsigned_data(unsigned char *data, int w, int h, bool flip_y=false);
     void from_unsigned_data(unsigned int *data, int w, int h);
 
+    /* u8 <-> float kernels over n channel values */
+    static void u8_to_float(const unsigned char *src, float *dst, size_t n);
+    static void float_to_u8(const float *src, unsigned char *dst, size_t n);
+
     void padding(int i, int j, int w, int h, int &outi, int &outj) const;
     static unsigned int vec3_uint(glm::vec3 v);
     static unsigned int vec4_uint(glm::vec4 v);
@@ -74,5 +85,6 @@ private:
     void init(int w, int h);
     bool ind_check(int i, int j);
     void init_buffer();
+    bool write(const std::string fname) const;
     Image norm_minmax(bool alpha);
 };
@@ -1,4 +1 @@
 #include "Logger.h"
-
-logger *logger::m_instance;
-
@@ -1,6 +1,7 @@
 #pragma once
 #include <iostream>
 #include <sstream>
+#include <mutex>
 
 #define FMT_HEADER_ONLY
 #include <fmt/core.h>
@@ -14,15 +15,14 @@ public:
 	~logger() {};
 
 	static logger* instance() {
-		if (!m_instance)
-			m_instance = new logger();
-
-		return m_instance;
+		static logger *inst = new logger();
+		return inst;
 	}
 
 	template<typename T, typename TT, typename TTT>
 	void dbg(const std::string s, T file, TT line, TTT func) {
 		std::string log_str = fmt::format("[DBG] {:50} \t [{}-{}-{}]\n", s, func, line, file);
+		std::lock_guard<std::mutex> guard(m_lock);
 		m_log_str += log_str;
         if (VERBOSE)
             std::cout << log_str;
@@ -31,6 +31,7 @@ public:
 	template<typename T, typename TT, typename TTT>
 	void info(const std::string s, T file, TT line, TTT func) {
 		std::string log_str = fmt::format("[INFO] {:50} \t [{}-{}-{}]\n", s, func, line, file);
+		std::lock_guard<std::mutex> guard(m_lock);
 		m_log_str += log_str;
         std::cout << log_str;
 	}
@@ -38,6 +39,7 @@ public:
 	template<typename T, typename TT, typename TTT>
 	void warn(const std::string s, T file, TT line, TTT func) {
 		std::string log_str = fmt::format("[WARN] {:50} \t [{}-{}-{}]\n", s, func, line, file);
+		std::lock_guard<std::mutex> guard(m_lock);
 		m_log_str += log_str;
 		std::cout << log_str;
 	}
@@ -45,15 +47,19 @@ public:
 	template<typename T, typename TT>
 	void error(const std::string s, T file, TT line, T func) {
 		std::string log_str = fmt::format("[ERROR] {:50} \t [{}-{}-{}]\n", s, func, line, file);
+		std::lock_guard<std::mutex> guard(m_lock);
 		m_log_str += log_str;
 		std::cerr << log_str;
 	}
 
-	std::string get_log() { return m_log_str; }
+	std::string get_log() {
+		std::lock_guard<std::mutex> guard(m_lock);
+		return m_log_str;
+	}
 
 private:
+	std::mutex m_lock;	/* loaders log from worker threads */
 	std::string m_log_str;
-	static logger *m_instance;
 };
 
 #ifndef DBG 
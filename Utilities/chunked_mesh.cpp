@@ -0,0 +1,631 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <omp.h>
+
+#include "chunked_mesh.h"
+#include "mapped_file.h"
+#include "Utils.h"
+#include "Logger.h"
+
+namespace {
+    const char chunk_magic[8] = {'G', 'L', 'C', 'H', 'U', 'N', 'K', '1'};
+    const uint32_t chunk_version = 1;
+
+    struct chunk_file_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t chunk_num;
+        uint64_t tri_num;
+        uint64_t table_offset;
+        float bb_min[3], bb_max[3];
+        uint64_t padding;
+    };
+    static_assert(sizeof(chunk_file_header) == 64, "chunk file header should be 64 bytes");
+
+    struct chunk_file_entry {
+        uint64_t offset;
+        uint64_t tri_num;
+        float bb_min[3], bb_max[3];
+    };
+    static_assert(sizeof(chunk_file_entry) == 40, "chunk table entry should be 40 bytes");
+
+    const size_t tri_bytes = 3 * sizeof(glm::vec3);
+
+    uint32_t part1by2(uint32_t x) {
+        x &= 0x3ff;
+        x = (x | (x << 16)) & 0x030000ff;
+        x = (x | (x << 8))  & 0x0300f00f;
+        x = (x | (x << 4))  & 0x030c30c3;
+        x = (x | (x << 2))  & 0x09249249;
+        return x;
+    }
+
+    AABB triangle_bounds(const glm::vec3 *v, size_t n) {
+        AABB ret;
+        for (size_t i = 0; i < n; ++i) {
+            ret.add_point(v[i]);
+        }
+        return ret;
+    }
+}
+
+
+//------- Chunk --------//
+std::shared_ptr<mesh> mesh_chunk::to_mesh() const {
+    auto ret = std::make_shared<mesh>();
+    ret->m_verts = verts;
+    ret->recompute_normal();
+    return ret;
+}
+
+
+//------- Builder --------//
+chunked_mesh_builder::chunked_mesh_builder(const std::string fname, const AABB &bounds, chunked_mesh_options opt):
+    m_fname(fname),
+    m_bounds(bounds),
+    m_opt(opt) {
+    m_opt.grid = glm::clamp(m_opt.grid, 1, 1024);
+    m_opt.chunk_tris = std::max<size_t>(m_opt.chunk_tris, 1);
+    m_cells.resize((size_t)m_opt.grid * m_opt.grid * m_opt.grid);
+}
+
+chunked_mesh_builder::~chunked_mesh_builder() {
+    if (m_spill.is_open()) {
+        m_spill.close();
+    }
+    if (!m_spill_name.empty()) {
+        boost::system::error_code ec;
+        fs::remove(m_spill_name, ec);
+    }
+}
+
+int chunked_mesh_builder::cell_of(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+    glm::vec3 extent = glm::max(m_bounds.p1 - m_bounds.p0, glm::vec3(1e-20f));
+    glm::vec3 rel = ((a + b + c) / 3.0f - m_bounds.p0) / extent * (float)m_opt.grid;
+
+    int g = m_opt.grid;
+    int x = glm::clamp((int)rel.x, 0, g - 1);
+    int y = glm::clamp((int)rel.y, 0, g - 1);
+    int z = glm::clamp((int)rel.z, 0, g - 1);
+    return x + g * (y + g * z);
+}
+
+void chunked_mesh_builder::add_triangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+    if (m_finished) {
+        return;
+    }
+
+    auto &buffer = m_cells[cell_of(a, b, c)].buffer;
+    buffer.push_back(a);
+    buffer.push_back(b);
+    buffer.push_back(c);
+    ++m_buffered;
+    ++m_tri_num;
+
+    if (m_buffered * tri_bytes > m_opt.buffer_bytes) {
+        m_failed |= !spill();
+    }
+}
+
+void chunked_mesh_builder::add_triangles(const glm::vec3 *verts, size_t tri_num) {
+    for (size_t ti = 0; ti < tri_num; ++ti) {
+        add_triangle(verts[ti * 3 + 0], verts[ti * 3 + 1], verts[ti * 3 + 2]);
+    }
+}
+
+/* Move every buffered triangle to the spill file and free the buffers */
+bool chunked_mesh_builder::spill() {
+    if (!m_spill.is_open()) {
+        m_spill_name = (fs::path(m_fname).parent_path() / fs::unique_path("%%%%-%%%%.spill")).string();
+        m_spill.open(m_spill_name, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!m_spill.is_open()) {
+            ERROR("Cannot open spill file {}", m_spill_name);
+            return false;
+        }
+    }
+
+    m_spill.seekp(m_spill_bytes);
+    for (auto &c:m_cells) {
+        if (c.buffer.empty()) {
+            continue;
+        }
+
+        m_spill.write(reinterpret_cast<const char*>(c.buffer.data()), c.buffer.size() * sizeof(glm::vec3));
+        c.spilled.push_back({m_spill_bytes, c.buffer.size() / 3});
+        m_spill_bytes += c.buffer.size() * sizeof(glm::vec3);
+        std::vector<glm::vec3>().swap(c.buffer);
+    }
+    m_buffered = 0;
+
+    if (!m_spill.good()) {
+        ERROR("Writing spill file {} failed", m_spill_name);
+        return false;
+    }
+    return true;
+}
+
+bool chunked_mesh_builder::finish() {
+    if (m_finished) {
+        return false;
+    }
+    m_finished = true;
+
+    if (m_failed) {
+        return false;
+    }
+
+    std::ofstream output(m_fname, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        ERROR("Cannot open {}", m_fname);
+        return false;
+    }
+
+    chunk_file_header header;
+    memset(&header, 0, sizeof(header));
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t offset = sizeof(header);
+
+    std::vector<chunk_file_entry> table;
+    std::vector<glm::vec3> chunk;
+    chunk.reserve(m_opt.chunk_tris * 3);
+
+    auto emit = [&]() {
+        if (chunk.empty()) {
+            return;
+        }
+
+        AABB bounds = triangle_bounds(chunk.data(), chunk.size());
+        chunk_file_entry e;
+        e.offset  = offset;
+        e.tri_num = chunk.size() / 3;
+        memcpy(e.bb_min, &bounds.p0, sizeof(e.bb_min));
+        memcpy(e.bb_max, &bounds.p1, sizeof(e.bb_max));
+        table.push_back(e);
+
+        output.write(reinterpret_cast<const char*>(chunk.data()), chunk.size() * sizeof(glm::vec3));
+        offset += chunk.size() * sizeof(glm::vec3);
+        chunk.clear();
+    };
+
+    /* Append triangles, a chunk is written whenever it is full */
+    auto append = [&](const glm::vec3 *v, size_t tri_num) {
+        while (tri_num > 0) {
+            size_t n = std::min(tri_num, m_opt.chunk_tris - chunk.size() / 3);
+            chunk.insert(chunk.end(), v, v + n * 3);
+            v += n * 3;
+            tri_num -= n;
+            if (chunk.size() / 3 == m_opt.chunk_tris) {
+                emit();
+            }
+        }
+    };
+
+    /* Cells in Morton order */
+    int g = m_opt.grid;
+    std::vector<std::pair<uint32_t, int>> order;
+    for (int ci = 0; ci < (int)m_cells.size(); ++ci) {
+        if (!m_cells[ci].buffer.empty() || !m_cells[ci].spilled.empty()) {
+            uint32_t x = ci % g, y = (ci / g) % g, z = ci / (g * g);
+            order.push_back({part1by2(x) | (part1by2(y) << 1) | (part1by2(z) << 2), ci});
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    if (m_spill.is_open()) {
+        m_spill.flush();
+    }
+
+    std::vector<glm::vec3> block;
+    for (auto &o:order) {
+        cell &c = m_cells[o.second];
+        for (auto &s:c.spilled) {
+            /* Spilled blocks are read back piece by piece, memory stays bounded */
+            uint64_t done = 0;
+            while (done < s.second) {
+                size_t n = (size_t)std::min<uint64_t>(s.second - done, m_opt.chunk_tris);
+                block.resize(n * 3);
+                m_spill.seekg(s.first + done * tri_bytes);
+                m_spill.read(reinterpret_cast<char*>(block.data()), n * tri_bytes);
+                if (!m_spill.good()) {
+                    ERROR("Reading spill file {} failed", m_spill_name);
+                    return false;
+                }
+                append(block.data(), n);
+                done += n;
+            }
+        }
+        append(c.buffer.data(), c.buffer.size() / 3);
+        std::vector<glm::vec3>().swap(c.buffer);
+
+        /* Chunks never span cells */
+        emit();
+    }
+
+    memcpy(header.magic, chunk_magic, sizeof(chunk_magic));
+    header.version      = chunk_version;
+    header.chunk_num    = (uint32_t)table.size();
+    header.tri_num      = m_tri_num;
+    header.table_offset = offset;
+    AABB bounds;
+    for (auto &e:table) {
+        bounds.add_point(glm::vec3(e.bb_min[0], e.bb_min[1], e.bb_min[2]));
+        bounds.add_point(glm::vec3(e.bb_max[0], e.bb_max[1], e.bb_max[2]));
+    }
+    memcpy(header.bb_min, &bounds.p0, sizeof(header.bb_min));
+    memcpy(header.bb_max, &bounds.p1, sizeof(header.bb_max));
+
+    output.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(chunk_file_entry));
+    output.seekp(0);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (!output.good()) {
+        ERROR("Writing {} failed", m_fname);
+        return false;
+    }
+    return true;
+}
+
+
+//------- Reader --------//
+chunked_mesh::chunked_mesh(const std::string fname, size_t budget):m_budget(budget) {
+    open(fname);
+}
+
+bool chunked_mesh::open(const std::string fname) {
+    close();
+
+    m_input.open(fname, std::ios::in | std::ios::binary);
+    if (!m_input.is_open()) {
+        WARN("Cannot open {}", fname);
+        return false;
+    }
+
+    chunk_file_header header;
+    m_input.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!m_input.good() || memcmp(header.magic, chunk_magic, sizeof(chunk_magic)) != 0 || header.version != chunk_version) {
+        ERROR("{} is not a chunk file", fname);
+        close();
+        return false;
+    }
+
+    std::vector<chunk_file_entry> table(header.chunk_num);
+    m_input.seekg(header.table_offset);
+    m_input.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(chunk_file_entry));
+    if (!m_input.good()) {
+        ERROR("{} has a broken chunk table", fname);
+        close();
+        return false;
+    }
+
+    for (auto &e:table) {
+        AABB bounds(glm::vec3(e.bb_min[0], e.bb_min[1], e.bb_min[2]), glm::vec3(e.bb_max[0], e.bb_max[1], e.bb_max[2]));
+        m_chunks.push_back({e.offset, e.tri_num, bounds});
+    }
+
+    m_fname   = fname;
+    m_tri_num = header.tri_num;
+    m_bounds  = AABB(glm::vec3(header.bb_min[0], header.bb_min[1], header.bb_min[2]),
+                     glm::vec3(header.bb_max[0], header.bb_max[1], header.bb_max[2]));
+    return true;
+}
+
+void chunked_mesh::close() {
+    release_all();
+    if (m_input.is_open()) {
+        m_input.close();
+    }
+    m_input.clear();
+    m_chunks.clear();
+    m_fname.clear();
+    m_tri_num = 0;
+    m_bounds = AABB();
+}
+
+bool chunked_mesh::read_chunk(size_t i, mesh_chunk &out) {
+    const chunk_entry &e = m_chunks[i];
+    out.bounds = e.bounds;
+    out.verts.resize(e.tri_num * 3);
+
+    std::lock_guard<std::mutex> guard(m_io_lock);
+    m_input.seekg(e.offset);
+    m_input.read(reinterpret_cast<char*>(out.verts.data()), e.tri_num * tri_bytes);
+    if (!m_input.good()) {
+        m_input.clear();
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const mesh_chunk> chunked_mesh::get_chunk(size_t i) {
+    if (i >= m_chunks.size()) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto it = m_resident.find(i);
+        if (it != m_resident.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            ++m_hits;
+            return it->second.chunk;
+        }
+    }
+
+    /* Read without holding the cache lock */
+    ++m_misses;
+    auto chunk = std::make_shared<mesh_chunk>();
+    if (!read_chunk(i, *chunk)) {
+        ERROR("Reading chunk {} of {} failed", i, m_fname);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    auto it = m_resident.find(i);
+    if (it != m_resident.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        return it->second.chunk;
+    }
+
+    m_lru.push_front(i);
+    m_resident[i] = {chunk, m_lru.begin()};
+    m_bytes += chunk->bytes();
+    evict();
+    return chunk;
+}
+
+void chunked_mesh::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_budget = bytes;
+    evict();
+}
+
+size_t chunked_mesh::resident_bytes() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_bytes;
+}
+
+void chunked_mesh::release_all() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_resident.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+/* m_lock is held by the caller. Chunks still referenced are skipped, dropping them frees nothing */
+void chunked_mesh::evict() {
+    auto it = m_lru.end();
+    while (m_bytes > m_budget && it != m_lru.begin()) {
+        --it;
+        auto &r = m_resident.at(*it);
+        if (r.chunk.use_count() > 1) {
+            continue;
+        }
+
+        m_bytes -= r.chunk->bytes();
+        m_resident.erase(*it);
+        it = m_lru.erase(it);
+    }
+}
+
+bool chunked_mesh::for_each_chunk(std::function<void(size_t, const mesh_chunk&)> f, bool parallel) {
+    std::atomic<bool> ok(true);
+    long long n = (long long)m_chunks.size();
+
+#pragma omp parallel for schedule(dynamic) if(parallel)
+    for (long long ci = 0; ci < n; ++ci) {
+        auto chunk = get_chunk(ci);
+        if (!chunk) {
+            ok = false;
+            continue;
+        }
+        f(ci, *chunk);
+    }
+    return ok;
+}
+
+AABB chunked_mesh::compute_bounds(const glm::mat4 &world) {
+    if (world == glm::mat4(1.0f)) {
+        return m_bounds;
+    }
+
+    std::mutex lock;
+    AABB ret;
+    for_each_chunk([&](size_t, const mesh_chunk &c) {
+        AABB local;
+        for (auto &v:c.verts) {
+            local.add_point(glm::vec3(world * glm::vec4(v, 1.0f)));
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        ret.add_aabb(local);
+    });
+    return ret;
+}
+
+bool chunked_mesh::voxelize(int res, std::vector<uint8_t> &occupancy, glm::ivec3 &dims, AABB &grid_bounds) {
+    if (res <= 0 || m_chunks.empty()) {
+        return false;
+    }
+
+    glm::vec3 extent = m_bounds.p1 - m_bounds.p0;
+    float size = std::max(extent.x, std::max(extent.y, extent.z)) / res;
+    if (size <= 0.0f) {
+        size = 1.0f;
+    }
+
+    dims = glm::ivec3(std::max(1, (int)std::ceil(extent.x / size)),
+                      std::max(1, (int)std::ceil(extent.y / size)),
+                      std::max(1, (int)std::ceil(extent.z / size)));
+    grid_bounds = AABB(m_bounds.p0, m_bounds.p0 + glm::vec3((float)dims.x, (float)dims.y, (float)dims.z) * size);
+    occupancy.assign((size_t)dims.x * dims.y * dims.z, 0);
+
+    glm::vec3 half(0.5f * size);
+    glm::vec3 origin = m_bounds.p0;
+    auto cell = [&](const glm::vec3 &p) {
+        glm::ivec3 ret;
+        for (int k = 0; k < 3; ++k) {
+            ret[k] = glm::clamp((int)((p[k] - origin[k]) / size), 0, dims[k] - 1);
+        }
+        return ret;
+    };
+
+    /* Voxels in the triangle bounds that its plane passes through */
+    return for_each_chunk([&](size_t, const mesh_chunk &c) {
+        for (size_t ti = 0; ti < c.tri_num(); ++ti) {
+            const glm::vec3 *v = &c.verts[ti * 3];
+            glm::vec3 n = glm::cross(v[1] - v[0], v[2] - v[0]);
+            glm::vec3 abs_n = glm::abs(n);
+            float r = glm::dot(abs_n, half);
+
+            glm::ivec3 lo = cell(glm::min(v[0], glm::min(v[1], v[2])));
+            glm::ivec3 hi = cell(glm::max(v[0], glm::max(v[1], v[2])));
+            for (int z = lo.z; z <= hi.z; ++z) {
+                for (int y = lo.y; y <= hi.y; ++y) {
+                    for (int x = lo.x; x <= hi.x; ++x) {
+                        glm::vec3 center = origin + (glm::vec3(x, y, z) + 0.5f) * size;
+                        if (std::abs(glm::dot(n, center - v[0])) > r) {
+                            continue;
+                        }
+
+                        uint8_t &o = occupancy[x + (size_t)dims.x * (y + (size_t)dims.y * z)];
+#pragma omp atomic write
+                        o = 1;
+                    }
+                }
+            }
+        }
+    });
+}
+
+std::vector<chunk_bvh_node> chunked_mesh::build_bvh(std::vector<int> &order, int leaf_size) const {
+    std::vector<chunk_bvh_node> nodes;
+    order.resize(m_chunks.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (m_chunks.empty()) {
+        return nodes;
+    }
+
+    leaf_size = std::max(leaf_size, 1);
+    std::vector<glm::vec3> centers(m_chunks.size());
+    for (size_t ci = 0; ci < m_chunks.size(); ++ci) {
+        AABB b = m_chunks[ci].bounds;
+        centers[ci] = b.center();
+    }
+
+    /* Median split on the longest axis of the centers */
+    struct task { int node, first, count; };
+    std::vector<task> stack;
+    nodes.push_back(chunk_bvh_node());
+    stack.push_back({0, 0, (int)order.size()});
+
+    while (!stack.empty()) {
+        task t = stack.back();
+        stack.pop_back();
+
+        AABB bounds, center_bounds;
+        for (int i = t.first; i < t.first + t.count; ++i) {
+            bounds.add_aabb(m_chunks[order[i]].bounds);
+            center_bounds.add_point(centers[order[i]]);
+        }
+        nodes[t.node].bounds = bounds;
+        nodes[t.node].first  = t.first;
+        nodes[t.node].count  = t.count;
+
+        if (t.count <= leaf_size) {
+            continue;
+        }
+
+        glm::vec3 extent = center_bounds.diagonal();
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        int mid = t.first + t.count / 2;
+        std::nth_element(order.begin() + t.first, order.begin() + mid, order.begin() + t.first + t.count, [&](int a, int b) {
+            return centers[a][axis] < centers[b][axis];
+        });
+
+        int left = (int)nodes.size();
+        nodes.push_back(chunk_bvh_node());
+        nodes.push_back(chunk_bvh_node());
+        nodes[t.node].left  = left;
+        nodes[t.node].right = left + 1;
+        stack.push_back({left, t.first, mid - t.first});
+        stack.push_back({left + 1, mid, t.first + t.count - mid});
+    }
+    return nodes;
+}
+
+
+namespace purdue {
+    namespace {
+        const size_t stl_header_size = 84;
+        const size_t stl_facet_size  = 50;
+
+        /* Binary STL if the size matches the triangle count */
+        bool binary_stl(const mapped_file &file, uint32_t &tri_num) {
+            if (file.size() < stl_header_size) {
+                return false;
+            }
+            memcpy(&tri_num, file.data() + 80, sizeof(tri_num));
+            return file.size() == stl_header_size + (size_t)tri_num * stl_facet_size;
+        }
+
+        void read_facet(const char *data, size_t ti, glm::vec3 *v) {
+            float f[9];
+            memcpy(f, data + stl_header_size + ti * stl_facet_size + 12, sizeof(f));
+            v[0] = glm::vec3(f[0], f[1], f[2]);
+            v[1] = glm::vec3(f[3], f[4], f[5]);
+            v[2] = glm::vec3(f[6], f[7], f[8]);
+        }
+
+        bool build_from_stl(const mapped_file &file, uint32_t tri_num, const std::string out, chunked_mesh_options opt) {
+            const char *data = file.data();
+
+            /* Pass 1: bounds */
+            AABB bounds;
+#pragma omp parallel
+            {
+                AABB local;
+#pragma omp for nowait
+                for (long long ti = 0; ti < (long long)tri_num; ++ti) {
+                    glm::vec3 v[3];
+                    read_facet(data, ti, v);
+                    for (int k = 0; k < 3; ++k) local.add_point(v[k]);
+                }
+#pragma omp critical
+                bounds.add_aabb(local);
+            }
+
+            /* Pass 2: binning, pages of the mapping are dropped by the kernel as needed */
+            chunked_mesh_builder builder(out, bounds, opt);
+            for (size_t ti = 0; ti < tri_num; ++ti) {
+                glm::vec3 v[3];
+                read_facet(data, ti, v);
+                builder.add_triangle(v[0], v[1], v[2]);
+            }
+            return builder.finish();
+        }
+    }
+
+    bool build_chunked_mesh(const std::string source, const std::string out, chunked_mesh_options opt) {
+        mapped_file file;
+        uint32_t tri_num = 0;
+        if (file.open(source) && binary_stl(file, tri_num)) {
+            file.advise_sequential();
+            return build_from_stl(file, tri_num, out, opt);
+        }
+        file.close();
+
+        auto m = std::make_shared<mesh>();
+        if (!load_model(source, m)) {
+            return false;
+        }
+        return build_chunked_mesh(m->m_verts, out, opt);
+    }
+
+    bool build_chunked_mesh(const std::vector<glm::vec3> &verts, const std::string out, chunked_mesh_options opt) {
+        AABB bounds = triangle_bounds(verts.data(), verts.size());
+        chunked_mesh_builder builder(out, bounds, opt);
+        builder.add_triangles(verts.data(), verts.size() / 3);
+        return builder.finish();
+    }
+}
@@ -0,0 +1,179 @@
+/* Out-of-core triangle meshes
+ *
+ *  Geometry is binned by triangle centroid into a uniform grid and stored as
+ *  chunks of at most chunk_tris triangles. Chunks of one cell are contiguous
+ *  and cells are written in Morton order, so neighbouring chunks are close in
+ *  space. Every chunk has its bounds in the chunk table.
+ *
+ *  Layout:
+ *    header (64 bytes): magic "GLCHUNK1", version, chunk num, triangle num,
+ *                       table offset, bounds
+ *    chunk data: positions, vec3 * 3 * triangles per chunk
+ *    chunk table: {offset, triangles, bounds} per chunk
+ *
+ *  Building keeps at most buffer_bytes of triangles in memory, the rest is
+ *  spilled to a temporary file next to the output. Reading pages chunks in on
+ *  demand through an LRU cache bounded by the budget. Normals are not stored,
+ *  chunk meshes get face normals.
+ * */
+#pragma once
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <common.h>
+
+#include "Render/mesh.h"
+
+struct chunked_mesh_options {
+    int grid = 16;                          /* binning cells per axis */
+    size_t chunk_tris = 1 << 16;            /* max triangles per chunk */
+    size_t buffer_bytes = (size_t)256 << 20; /* builder memory before spilling */
+};
+
+/* One chunk paged in */
+struct mesh_chunk {
+    AABB bounds;
+    std::vector<glm::vec3> verts;           /* triangle soup */
+
+    size_t tri_num() const { return verts.size() / 3; }
+    size_t bytes() const { return verts.capacity() * sizeof(glm::vec3); }
+    std::shared_ptr<mesh> to_mesh() const;
+};
+
+/* Node of the chunk level BVH, leaves reference [first, first + count) of the order */
+struct chunk_bvh_node {
+    AABB bounds;
+    int left = -1, right = -1;
+    int first = 0, count = 0;
+
+    bool is_leaf() const { return left < 0; }
+};
+
+/* Streams triangles into a chunk file, not thread safe */
+class chunked_mesh_builder {
+public:
+    /* bounds: of all triangles that will be added, used for binning */
+    chunked_mesh_builder(const std::string fname, const AABB &bounds, chunked_mesh_options opt=chunked_mesh_options());
+    ~chunked_mesh_builder();
+
+    chunked_mesh_builder(const chunked_mesh_builder&) = delete;
+    chunked_mesh_builder& operator=(const chunked_mesh_builder&) = delete;
+
+    void add_triangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+    void add_triangles(const glm::vec3 *verts, size_t tri_num);
+
+    /* Writes the chunk file, the builder cannot be used afterwards */
+    bool finish();
+
+private:
+    struct cell {
+        std::vector<glm::vec3> buffer;
+        std::vector<std::pair<uint64_t, uint64_t>> spilled;   /* offset, triangles */
+    };
+
+    int cell_of(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+    bool spill();
+
+private:
+    std::string m_fname, m_spill_name;
+    AABB m_bounds;
+    chunked_mesh_options m_opt;
+    std::vector<cell> m_cells;
+    std::fstream m_spill;
+    uint64_t m_spill_bytes = 0;
+    size_t m_buffered = 0;      /* triangles in memory */
+    size_t m_tri_num = 0;
+    bool m_failed = false, m_finished = false;
+};
+
+/* Read side, chunks are paged in through an LRU cache */
+class chunked_mesh {
+public:
+    chunked_mesh() = default;
+    chunked_mesh(const std::string fname, size_t budget=(size_t)1 << 30);
+    ~chunked_mesh() = default;
+
+    chunked_mesh(const chunked_mesh&) = delete;
+    chunked_mesh& operator=(const chunked_mesh&) = delete;
+
+    bool open(const std::string fname);
+    void close();
+    bool is_open() { return m_input.is_open(); }
+
+    size_t chunk_num() const { return m_chunks.size(); }
+    size_t tri_num() const { return m_tri_num; }
+    AABB bounds() const { return m_bounds; }
+    AABB chunk_bounds(size_t i) const { return m_chunks.at(i).bounds; }
+    size_t chunk_tri_num(size_t i) const { return m_chunks.at(i).tri_num; }
+
+    /* Pages the chunk in if needed, nullptr if reading fails.
+     * The chunk stays resident at least while the pointer is held. */
+    std::shared_ptr<const mesh_chunk> get_chunk(size_t i);
+
+    /* Memory budget of resident chunks in bytes */
+    void set_budget(size_t bytes);
+    size_t get_budget() { return m_budget; }
+    size_t resident_bytes();
+    void release_all();
+
+    /* Statistics */
+    size_t hits() { return m_hits; }
+    size_t misses() { return m_misses; }
+
+    /* Streaming pass over every chunk in file order, f(chunk index, chunk).
+     * Parallel passes keep up to #threads chunks besides the cache. */
+    bool for_each_chunk(std::function<void(size_t, const mesh_chunk&)> f, bool parallel=true);
+
+    //------- Streaming passes --------//
+    /* Exact bounds after transforming by world */
+    AABB compute_bounds(const glm::mat4 &world=glm::mat4(1.0f));
+
+    /* Conservative surface voxelization, res cells along the longest axis.
+     * occupancy[x + dims.x * (y + dims.y * z)] is 1 for voxels touched by a triangle */
+    bool voxelize(int res, std::vector<uint8_t> &occupancy, glm::ivec3 &dims, AABB &grid_bounds);
+
+    /* BVH over chunk bounds, leaves hold up to leaf_size chunks listed in order.
+     * Only the chunk table is used, nothing is paged in */
+    std::vector<chunk_bvh_node> build_bvh(std::vector<int> &order, int leaf_size=1) const;
+
+private:
+    struct chunk_entry {
+        uint64_t offset;
+        uint64_t tri_num;
+        AABB bounds;
+    };
+
+    struct resident {
+        std::shared_ptr<const mesh_chunk> chunk;
+        std::list<size_t>::iterator lru;
+    };
+
+    bool read_chunk(size_t i, mesh_chunk &out);
+    void evict();
+
+private:
+    std::string m_fname;
+    std::ifstream m_input;
+    std::vector<chunk_entry> m_chunks;
+    AABB m_bounds;
+    size_t m_tri_num = 0;
+
+    std::mutex m_lock, m_io_lock;
+    std::unordered_map<size_t, resident> m_resident;
+    std::list<size_t> m_lru;             /* front is the most recently used */
+    size_t m_budget = (size_t)1 << 30;
+    size_t m_bytes = 0;
+    std::atomic<size_t> m_hits{0}, m_misses{0};
+};
+
+namespace purdue {
+    /* Build a chunk file from a mesh file. Binary STL is streamed from a memory
+     * map in two passes (bounds, binning) and never loaded as a whole, other
+     * formats are loaded first. */
+    bool build_chunked_mesh(const std::string source, const std::string out, chunked_mesh_options opt=chunked_mesh_options());
+
+    /* Build from a triangle soup in memory */
+    bool build_chunked_mesh(const std::vector<glm::vec3> &verts, const std::string out, chunked_mesh_options opt=chunked_mesh_options());
+}
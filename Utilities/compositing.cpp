@@ -0,0 +1,138 @@
+#include <algorithm>
+
+#include "compositing.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        bool check_layers(const std::vector<composite_layer> &layers, int &w, int &h) {
+            if (layers.empty()) {
+                ERROR("Nothing to composite");
+                return false;
+            }
+
+            for (auto &l:layers) {
+                if (l.img == nullptr) {
+                    ERROR("Composite layer has no image");
+                    return false;
+                }
+            }
+
+            w = layers[0].img->width();
+            h = layers[0].img->height();
+            for (auto &l:layers) {
+                if (l.img->width() != w || l.img->height() != h) {
+                    ERROR("Composite layer size ({},{}) does not match ({},{})", l.img->width(), l.img->height(), w, h);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /* Blend one layer row into dst row, both premultiplied */
+        void blend_row(const composite_layer &layer, int j, int w, glm::vec4 *dst) {
+            const glm::vec4 *src = layer.img->data() + (size_t)j * w;
+            const float opacity = layer.opacity;
+
+            switch (layer.mode) {
+            case blend_mode::over:
+            case blend_mode::multiply:
+            case blend_mode::screen:
+#pragma omp simd
+                for (int i = 0; i < w; ++i) {
+                    glm::vec4 s = src[i];
+                    if (!layer.premultiplied) {
+                        s = glm::vec4(glm::vec3(s) * s.a, s.a);
+                    }
+                    s = s * opacity;
+
+                    glm::vec4 d = dst[i];
+                    glm::vec3 sc(s), dc(d);
+                    glm::vec3 c;
+                    if (layer.mode == blend_mode::over) {
+                        c = sc + dc * (1.0f - s.a);
+                    } else if (layer.mode == blend_mode::multiply) {
+                        c = sc * dc + sc * (1.0f - d.a) + dc * (1.0f - s.a);
+                    } else {
+                        c = sc + dc - sc * dc;
+                    }
+                    dst[i] = glm::vec4(c, s.a + d.a * (1.0f - s.a));
+                }
+                break;
+
+            case blend_mode::shadow:
+#pragma omp simd
+                for (int i = 0; i < w; ++i) {
+                    float m = std::min(std::max(src[i].r * opacity, 0.0f), 1.0f);
+                    glm::vec4 d = dst[i];
+                    dst[i] = glm::vec4(layer.shadow_color * m + glm::vec3(d) * (1.0f - m), m + d.a * (1.0f - m));
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        void composite_row(const std::vector<composite_layer> &layers, int j, int w, glm::vec4 *dst, bool premultiplied_out) {
+            std::fill(dst, dst + w, glm::vec4(0.0f));
+            for (auto &l:layers) {
+                blend_row(l, j, w, dst);
+            }
+
+            if (premultiplied_out) {
+                return;
+            }
+
+#pragma omp simd
+            for (int i = 0; i < w; ++i) {
+                float a = dst[i].a;
+                float inv = a > 0.0f ? 1.0f / a : 0.0f;
+                dst[i] = glm::vec4(glm::vec3(dst[i]) * inv, a);
+            }
+        }
+    }
+
+    bool composite(const std::vector<composite_layer> &layers, Image &out, bool premultiplied_out) {
+        int w, h;
+        if (!check_layers(layers, w, h)) {
+            return false;
+        }
+
+        for (auto &l:layers) {
+            if (l.img == &out) {
+                ERROR("Composite output cannot be one of the layers");
+                return false;
+            }
+        }
+
+        if (out.width() != w || out.height() != h) {
+            out = Image(w, h);
+        }
+
+        glm::vec4 *dst = out.data();
+#pragma omp parallel for
+        for (int j = 0; j < h; ++j) {
+            composite_row(layers, j, w, dst + (size_t)j * w, premultiplied_out);
+        }
+        return true;
+    }
+
+    bool composite(const std::vector<composite_layer> &layers, unsigned char *out, bool premultiplied_out) {
+        int w, h;
+        if (!check_layers(layers, w, h) || out == nullptr) {
+            return false;
+        }
+
+#pragma omp parallel
+        {
+            std::vector<glm::vec4> row(w);
+#pragma omp for
+            for (int j = 0; j < h; ++j) {
+                composite_row(layers, j, w, row.data(), premultiplied_out);
+                Image::float_to_u8(reinterpret_cast<const float*>(row.data()), out + (size_t)j * w * 4, (size_t)w * 4);
+            }
+        }
+        return true;
+    }
+}
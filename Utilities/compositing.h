@@ -0,0 +1,39 @@
+/* Layer compositing for dataset frames (background, shadow, object)
+ *
+ *  All blending is done in premultiplied alpha. Layers are listed bottom to
+ *  top and composited in one row-parallel pass, no intermediate images.
+ *
+ *  over:     d = s + d * (1 - s.a)
+ *  multiply: d.rgb = s.rgb * d.rgb + s.rgb * (1 - d.a) + d.rgb * (1 - s.a)
+ *  screen:   d.rgb = s.rgb + d.rgb - s.rgb * d.rgb
+ *  shadow:   layer r channel is a shadow mask m, d = shadow_color * m + d * (1 - m)
+ *  alpha is s.a + d.a * (1 - s.a) for every mode.
+ * */
+#pragma once
+#include <common.h>
+
+enum class blend_mode {
+    over,
+    multiply,
+    screen,
+    shadow
+};
+
+struct composite_layer {
+    const Image *img = nullptr;
+    blend_mode mode = blend_mode::over;
+    float opacity = 1.0f;
+    bool premultiplied = false;                 /* straight alpha layers are premultiplied on the fly */
+    glm::vec3 shadow_color = glm::vec3(0.0f);   /* shadow mode only */
+
+    composite_layer() = default;
+    composite_layer(const Image &img, blend_mode mode=blend_mode::over, float opacity=1.0f):img(&img), mode(mode), opacity(opacity) {}
+};
+
+namespace purdue {
+    /* out is resized to the layer size. Output is straight alpha unless premultiplied_out */
+    bool composite(const std::vector<composite_layer> &layers, Image &out, bool premultiplied_out=false);
+
+    /* RGBA8 output, out has w * h * 4 bytes. Straight alpha unless premultiplied_out */
+    bool composite(const std::vector<composite_layer> &layers, unsigned char *out, bool premultiplied_out=false);
+}
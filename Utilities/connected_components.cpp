@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <unordered_map>
+#include <omp.h>
+
+#include "connected_components.h"
+
+namespace purdue {
+    namespace {
+        /* Roots are always the smallest index of a tree, i.e. first pixel in scan order */
+        int find_root(std::vector<int> &parent, int p) {
+            while (parent[p] != p) {
+                parent[p] = parent[parent[p]];
+                p = parent[p];
+            }
+            return p;
+        }
+
+        int find_root_const(const std::vector<int> &parent, int p) {
+            while (parent[p] != p) {
+                p = parent[p];
+            }
+            return p;
+        }
+
+        void merge(std::vector<int> &parent, int a, int b) {
+            a = find_root(parent, a);
+            b = find_root(parent, b);
+            if (a == b) {
+                return;
+            }
+            if (a < b) {
+                parent[b] = a;
+            } else {
+                parent[a] = b;
+            }
+        }
+
+        /* Union p with its foreground neighbours on the left and in the row above, rows >= y_min */
+        void merge_neighbours(const unsigned char *mask, int w, int i, int j, int y_min, bool eight_connected, std::vector<int> &parent) {
+            int p = j * w + i;
+            if (i > 0 && mask[p - 1]) {
+                merge(parent, p, p - 1);
+            }
+
+            if (j <= y_min) {
+                return;
+            }
+
+            int up = p - w;
+            if (mask[up]) {
+                merge(parent, p, up);
+            }
+
+            if (eight_connected) {
+                if (i > 0 && mask[up - 1]) {
+                    merge(parent, p, up - 1);
+                }
+                if (i + 1 < w && mask[up + 1]) {
+                    merge(parent, p, up + 1);
+                }
+            }
+        }
+
+        struct stats_acc {
+            size_t area = 0;
+            glm::ivec2 bb_min, bb_max;
+            double sx = 0.0, sy = 0.0;
+
+            void add(int i, int j) {
+                if (area == 0) {
+                    bb_min = bb_max = glm::ivec2(i, j);
+                }
+                bb_min.x = std::min(bb_min.x, i); bb_min.y = std::min(bb_min.y, j);
+                bb_max.x = std::max(bb_max.x, i); bb_max.y = std::max(bb_max.y, j);
+                sx += i; sy += j;
+                ++area;
+            }
+
+            void add(const stats_acc &rhs) {
+                if (rhs.area == 0) {
+                    return;
+                }
+                if (area == 0) {
+                    *this = rhs;
+                    return;
+                }
+                bb_min.x = std::min(bb_min.x, rhs.bb_min.x); bb_min.y = std::min(bb_min.y, rhs.bb_min.y);
+                bb_max.x = std::max(bb_max.x, rhs.bb_max.x); bb_max.y = std::max(bb_max.y, rhs.bb_max.y);
+                sx += rhs.sx; sy += rhs.sy;
+                area += rhs.area;
+            }
+        };
+    }
+
+    std::vector<unsigned char> image_mask(const Image &img, float threshold) {
+        size_t n = (size_t)img.width() * img.height();
+        std::vector<unsigned char> ret(n);
+        const glm::vec4 *src = img.data();
+
+#pragma omp parallel for
+        for (long long i = 0; i < (long long)n; ++i) {
+            ret[i] = src[i].r > threshold ? 1 : 0;
+        }
+        return ret;
+    }
+
+    int connected_components(const unsigned char *mask, int w, int h, std::vector<int> &labels, std::vector<component_stats> &stats, bool eight_connected) {
+        size_t n = (size_t)w * h;
+        labels.assign(n, 0);
+        stats.clear();
+        if (n == 0) {
+            return 0;
+        }
+
+        int band_num = std::max(1, std::min(h, omp_get_max_threads()));
+        int band_h = (h + band_num - 1) / band_num;
+        band_num = (h + band_h - 1) / band_h;
+
+        /* 1. label every band independently, bands own disjoint index ranges */
+        std::vector<int> parent(n, -1);
+#pragma omp parallel for schedule(static, 1)
+        for (int b = 0; b < band_num; ++b) {
+            int y0 = b * band_h, y1 = std::min(h, y0 + band_h);
+            for (int j = y0; j < y1; ++j) {
+                for (int i = 0; i < w; ++i) {
+                    int p = j * w + i;
+                    if (!mask[p]) {
+                        continue;
+                    }
+
+                    parent[p] = p;
+                    merge_neighbours(mask, w, i, j, y0, eight_connected, parent);
+                }
+            }
+        }
+
+        /* 2. stitch band borders */
+        for (int b = 1; b < band_num; ++b) {
+            int j = b * band_h;
+            for (int i = 0; i < w; ++i) {
+                int p = j * w + i;
+                if (!mask[p]) {
+                    continue;
+                }
+
+                merge_neighbours(mask, w, i, j, j - 1, eight_connected, parent);
+            }
+        }
+
+        /* 3. compact labels for roots, in scan order. Kept apart from labels so
+         * step 4 can read the roots of other bands while writing its own */
+        std::vector<int> root_label(n, 0);
+        std::vector<int> band_offset(band_num + 1, 0);
+#pragma omp parallel for schedule(static, 1)
+        for (int b = 0; b < band_num; ++b) {
+            int p0 = b * band_h * w, p1 = std::min(h, (b + 1) * band_h) * w;
+            int cnt = 0;
+            for (int p = p0; p < p1; ++p) {
+                cnt += parent[p] == p;
+            }
+            band_offset[b + 1] = cnt;
+        }
+        for (int b = 0; b < band_num; ++b) {
+            band_offset[b + 1] += band_offset[b];
+        }
+
+        int label_num = band_offset[band_num];
+#pragma omp parallel for schedule(static, 1)
+        for (int b = 0; b < band_num; ++b) {
+            int p0 = b * band_h * w, p1 = std::min(h, (b + 1) * band_h) * w;
+            int next = band_offset[b] + 1;
+            for (int p = p0; p < p1; ++p) {
+                if (parent[p] == p) {
+                    root_label[p] = next++;
+                }
+            }
+        }
+
+        /* 4. label every pixel and accumulate statistics per band */
+        std::vector<std::unordered_map<int, stats_acc>> band_stats(band_num);
+#pragma omp parallel for schedule(static, 1)
+        for (int b = 0; b < band_num; ++b) {
+            auto &acc = band_stats[b];
+            int y0 = b * band_h, y1 = std::min(h, y0 + band_h);
+            int last_label = 0;
+            stats_acc *last = nullptr;
+
+            for (int j = y0; j < y1; ++j) {
+                for (int i = 0; i < w; ++i) {
+                    int p = j * w + i;
+                    if (!mask[p]) {
+                        continue;
+                    }
+
+                    int l = root_label[find_root_const(parent, p)];
+                    labels[p] = l;
+
+                    /* Runs of the same label are common, skip the lookup */
+                    if (l != last_label) {
+                        last = &acc[l];
+                        last_label = l;
+                    }
+                    last->add(i, j);
+                }
+            }
+        }
+
+        std::vector<stats_acc> total(label_num);
+        for (auto &acc:band_stats) for (auto &s:acc) {
+            total[s.first - 1].add(s.second);
+        }
+
+        stats.resize(label_num);
+#pragma omp parallel for
+        for (int k = 0; k < label_num; ++k) {
+            const stats_acc &t = total[k];
+            component_stats &s = stats[k];
+            s.label    = k + 1;
+            s.area     = t.area;
+            s.bb_min   = t.bb_min;
+            s.bb_max   = t.bb_max;
+            s.centroid = glm::vec2((float)(t.sx / t.area), (float)(t.sy / t.area));
+        }
+
+        return label_num;
+    }
+
+    int connected_components(const Image &mask, std::vector<int> &labels, std::vector<component_stats> &stats, float threshold, bool eight_connected) {
+        std::vector<unsigned char> m = image_mask(mask, threshold);
+        return connected_components(m.data(), mask.width(), mask.height(), labels, stats, eight_connected);
+    }
+}
@@ -0,0 +1,37 @@
+/* Connected component labelling on compact u8 masks
+ *
+ *  Rows are split into bands, each band is labelled by its own thread with
+ *  union-find, then band borders are merged. Labels are 1..n in scan order
+ *  of each component's first pixel, 0 is background.
+ *  Per label area, bounding box and centroid come out of the labelling pass.
+ * */
+#pragma once
+#include <common.h>
+
+struct component_stats {
+    int label;
+    size_t area;
+    glm::ivec2 bb_min, bb_max;      /* inclusive pixel bounds */
+    glm::vec2 centroid;
+};
+
+namespace purdue {
+    /* u8 mask from the r channel: 1 if r > threshold */
+    std::vector<unsigned char> image_mask(const Image &img, float threshold=0.5f);
+
+    /* mask: w * h, non-zero is foreground
+     * labels: resized to w * h
+     * stats: stats[k] belongs to label k + 1
+     * Returns number of components */
+    int connected_components(const unsigned char *mask,
+                             int w, int h,
+                             std::vector<int> &labels,
+                             std::vector<component_stats> &stats,
+                             bool eight_connected=false);
+
+    int connected_components(const Image &mask,
+                             std::vector<int> &labels,
+                             std::vector<component_stats> &stats,
+                             float threshold=0.5f,
+                             bool eight_connected=false);
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+
+#include "distance_transform.h"
+
+namespace purdue {
+    namespace {
+        /* Finite so parabola intersections stay well defined */
+        const float dt_inf = 1e20f;
+
+        /* 1D squared distance transform of f[0,n)
+         *   d[q]   = min_p (q-p)^2 + f[p]
+         *   arg[q] = argmin p
+         * v, z are scratch buffers of n and n+1 */
+        void dt_1d(const float *f, int n, float *d, int *arg, int *v, float *z) {
+            int k = 0;
+            v[0] = 0;
+            z[0] = -dt_inf;
+            z[1] = dt_inf;
+
+            for (int q = 1; q < n; ++q) {
+                float s = ((f[q] + (float)q * q) - (f[v[k]] + (float)v[k] * v[k])) / (2.0f * (q - v[k]));
+                while (s <= z[k]) {
+                    --k;
+                    s = ((f[q] + (float)q * q) - (f[v[k]] + (float)v[k] * v[k])) / (2.0f * (q - v[k]));
+                }
+
+                ++k;
+                v[k] = q;
+                z[k] = s;
+                z[k + 1] = dt_inf;
+            }
+
+            k = 0;
+            for (int q = 0; q < n; ++q) {
+                while (z[k + 1] < q) {
+                    ++k;
+                }
+                d[q] = (float)(q - v[k]) * (q - v[k]) + f[v[k]];
+                arg[q] = v[k];
+            }
+        }
+
+        /* foreground: foreground pixels are the sources, otherwise background pixels are */
+        void edt(const Image &mask, float threshold, bool foreground, std::vector<float> &sqr_dist, std::vector<int> &nearest) {
+            int w = mask.width(), h = mask.height();
+            size_t n = (size_t)w * h;
+            const glm::vec4 *src = mask.data();
+
+            sqr_dist.resize(n);
+            nearest.resize(n);
+            if (n == 0) {
+                return;
+            }
+
+            /* Column pass, nearest_y keeps the source row of every pixel */
+            std::vector<int> nearest_y(n);
+#pragma omp parallel
+            {
+                int len = std::max(w, h);
+                std::vector<float> f(len), d(len), z(len + 1);
+                std::vector<int> arg(len), v(len);
+
+#pragma omp for
+                for (int i = 0; i < w; ++i) {
+                    for (int j = 0; j < h; ++j) {
+                        bool fg = src[(size_t)j * w + i].r > threshold;
+                        f[j] = fg == foreground ? 0.0f : dt_inf;
+                    }
+
+                    dt_1d(f.data(), h, d.data(), arg.data(), v.data(), z.data());
+                    for (int j = 0; j < h; ++j) {
+                        size_t ind = (size_t)j * w + i;
+                        sqr_dist[ind]  = d[j];
+                        nearest_y[ind] = arg[j];
+                    }
+                }
+
+                /* Row pass */
+#pragma omp for
+                for (int j = 0; j < h; ++j) {
+                    size_t row = (size_t)j * w;
+                    dt_1d(&sqr_dist[row], w, d.data(), arg.data(), v.data(), z.data());
+                    for (int i = 0; i < w; ++i) {
+                        int ni = arg[i];
+                        sqr_dist[row + i] = d[i];
+                        nearest[row + i]  = d[i] >= dt_inf ? -1 : nearest_y[row + ni] * w + ni;
+                    }
+                }
+            }
+        }
+    }
+
+    void distance_transform(const Image &mask, std::vector<float> &sqr_dist, std::vector<int> &nearest, float threshold) {
+        edt(mask, threshold, true, sqr_dist, nearest);
+    }
+
+    Image distance_transform(const Image &mask, float threshold) {
+        std::vector<float> sqr_dist;
+        std::vector<int> nearest;
+        edt(mask, threshold, true, sqr_dist, nearest);
+
+        int w = mask.width(), h = mask.height();
+        Image ret(w, h);
+        glm::vec4 *dst = ret.data();
+#pragma omp parallel for
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i) {
+                size_t ind = (size_t)j * w + i;
+                float d = std::sqrt(sqr_dist[ind]);
+                dst[ind] = glm::vec4(d, d, d, 1.0f);
+            }
+        }
+        return ret;
+    }
+
+    Image signed_distance_transform(const Image &mask, float threshold) {
+        std::vector<float> outside, inside;
+        std::vector<int> nearest;
+        edt(mask, threshold, true, outside, nearest);
+        edt(mask, threshold, false, inside, nearest);
+
+        int w = mask.width(), h = mask.height();
+        Image ret(w, h);
+        glm::vec4 *dst = ret.data();
+#pragma omp parallel for
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i) {
+                size_t ind = (size_t)j * w + i;
+                float d = std::sqrt(outside[ind]) - std::sqrt(inside[ind]);
+                dst[ind] = glm::vec4(d, d, d, 1.0f);
+            }
+        }
+        return ret;
+    }
+}
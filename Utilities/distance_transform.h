@@ -0,0 +1,28 @@
+/* Exact Euclidean distance transform
+ *
+ *  Felzenszwalb & Huttenlocher, Distance Transforms of Sampled Functions.
+ *  Two separable 1D lower envelope passes (columns, then rows), O(N) overall,
+ *  every column / row is processed in parallel.
+ *
+ *  Mask pixels with r > threshold are foreground (e.g. shadow or caster).
+ * */
+#pragma once
+#include <common.h>
+
+namespace purdue {
+    /* Distance in pixels to the nearest foreground pixel, 0 on the foreground.
+     * Result is stored in rgb, alpha is 1. */
+    Image distance_transform(const Image &mask, float threshold=0.5f);
+
+    /* Low level version
+     *  sqr_dist: squared distance per pixel, w * h
+     *  nearest:  index j * w + i of the nearest foreground pixel, -1 if the mask is empty
+     */
+    void distance_transform(const Image &mask,
+                            std::vector<float> &sqr_dist,
+                            std::vector<int> &nearest,
+                            float threshold=0.5f);
+
+    /* Positive outside, negative inside: distance to foreground minus distance to background */
+    Image signed_distance_transform(const Image &mask, float threshold=0.5f);
+}
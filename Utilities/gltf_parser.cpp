@@ -0,0 +1,611 @@
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+
+#include <rapidjson/document.h>
+
+#include "gltf_parser.h"
+#include "mapped_file.h"
+#include "Utils.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        const uint32_t glb_magic  = 0x46546C67;    /* "glTF" */
+        const uint32_t chunk_json = 0x4E4F534A;    /* "JSON" */
+        const uint32_t chunk_bin  = 0x004E4942;    /* "BIN\0" */
+
+        enum component_type {
+            ct_i8 = 5120, ct_u8 = 5121, ct_i16 = 5122, ct_u16 = 5123, ct_u32 = 5125, ct_f32 = 5126
+        };
+
+        enum primitive_mode {
+            mode_triangles = 4, mode_strip = 5, mode_fan = 6
+        };
+
+        typedef rapidjson::Value json;
+
+        struct gltf_buffer {
+            const char *data = nullptr;
+            size_t size = 0;
+        };
+
+        /* Strided view of one accessor inside a buffer */
+        struct accessor_view {
+            const char *data = nullptr;
+            size_t stride = 0, count = 0;
+            int comp_type = 0, comps = 0;
+            bool normalized = false;
+
+            bool valid() const { return data != nullptr; }
+
+            static size_t comp_size(int type) {
+                switch (type) {
+                case ct_i8: case ct_u8:   return 1;
+                case ct_i16: case ct_u16: return 2;
+                case ct_u32: case ct_f32: return 4;
+                default: return 0;
+                }
+            }
+
+            bool tight_float(int n) const {
+                return comp_type == ct_f32 && comps == n && stride == n * sizeof(float);
+            }
+
+            float component(size_t i, int c) const {
+                const char *p = data + i * stride + c * comp_size(comp_type);
+                switch (comp_type) {
+                case ct_f32: { float v;    memcpy(&v, p, 4); return v; }
+                case ct_u8:  { uint8_t v;  memcpy(&v, p, 1); return normalized ? v / 255.0f : (float)v; }
+                case ct_i8:  { int8_t v;   memcpy(&v, p, 1); return normalized ? std::max(v / 127.0f, -1.0f) : (float)v; }
+                case ct_u16: { uint16_t v; memcpy(&v, p, 2); return normalized ? v / 65535.0f : (float)v; }
+                case ct_i16: { int16_t v;  memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : (float)v; }
+                case ct_u32: { uint32_t v; memcpy(&v, p, 4); return (float)v; }
+                default: return 0.0f;
+                }
+            }
+
+            glm::vec3 vec3(size_t i) const {
+                glm::vec3 ret(0.0f);
+                for (int c = 0; c < std::min(comps, 3); ++c) ret[c] = component(i, c);
+                return ret;
+            }
+
+            glm::vec2 vec2(size_t i) const {
+                glm::vec2 ret(0.0f);
+                for (int c = 0; c < std::min(comps, 2); ++c) ret[c] = component(i, c);
+                return ret;
+            }
+
+            uint32_t index(size_t i) const {
+                const char *p = data + i * stride;
+                switch (comp_type) {
+                case ct_u8:  { uint8_t v;  memcpy(&v, p, 1); return v; }
+                case ct_u16: { uint16_t v; memcpy(&v, p, 2); return v; }
+                case ct_u32: { uint32_t v; memcpy(&v, p, 4); return v; }
+                default: return 0;
+                }
+            }
+        };
+
+        /* One primitive placed by a node */
+        struct gltf_draw {
+            int mesh, prim;
+            glm::mat4 world;
+            bool identity;
+        };
+
+        int get_int(const json &v, const char *key, int def) {
+            return v.IsObject() && v.HasMember(key) && v[key].IsInt() ? v[key].GetInt() : def;
+        }
+
+        size_t get_size(const json &v, const char *key, size_t def) {
+            return v.IsObject() && v.HasMember(key) && v[key].IsUint64() ? (size_t)v[key].GetUint64() : def;
+        }
+
+        const json* get_array(const json &v, const char *key) {
+            return v.IsObject() && v.HasMember(key) && v[key].IsArray() ? &v[key] : nullptr;
+        }
+
+        /* False unless key is an array of exactly n numbers */
+        bool get_floats(const json &v, const char *key, rapidjson::SizeType n, float *out) {
+            const json *arr = get_array(v, key);
+            if (!arr || arr->Size() != n) {
+                return false;
+            }
+            for (rapidjson::SizeType i = 0; i < n; ++i) {
+                if (!(*arr)[i].IsNumber()) {
+                    return false;
+                }
+            }
+            for (rapidjson::SizeType i = 0; i < n; ++i) {
+                out[i] = (float)(*arr)[i].GetDouble();
+            }
+            return true;
+        }
+
+        /* i-th element of a top level array, nullptr if missing */
+        const json* get_item(const json &doc, const char *key, int i) {
+            const json *arr = get_array(doc, key);
+            if (!arr || i < 0 || i >= (int)arr->Size() || !(*arr)[(rapidjson::SizeType)i].IsObject()) {
+                return nullptr;
+            }
+            return &(*arr)[(rapidjson::SizeType)i];
+        }
+
+        bool decode_base64(const char *p, const char *end, std::vector<char> &out) {
+            static int8_t table[256];
+            static bool init = [] {
+                const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+                memset(table, -1, sizeof(table));
+                for (int i = 0; i < 64; ++i) table[(unsigned char)alphabet[i]] = (int8_t)i;
+                return true;
+            }();
+            (void)init;
+
+            out.clear();
+            out.reserve((end - p) / 4 * 3);
+            uint32_t acc = 0;
+            int bits = 0;
+            for (; p < end && *p != '='; ++p) {
+                int8_t v = table[(unsigned char)*p];
+                if (v < 0) {
+                    return false;
+                }
+                acc = (acc << 6) | (uint32_t)v;
+                bits += 6;
+                if (bits >= 8) {
+                    bits -= 8;
+                    out.push_back((char)((acc >> bits) & 0xff));
+                }
+            }
+            return true;
+        }
+
+        /* The memory every buffer points into */
+        struct gltf_storage {
+            std::vector<std::unique_ptr<mapped_file>> files;
+            std::vector<std::vector<char>> decoded;
+        };
+
+        bool load_buffers(const json &doc, const std::string &fname, gltf_buffer glb_bin, gltf_storage &storage, std::vector<gltf_buffer> &buffers) {
+            const json *arr = get_array(doc, "buffers");
+            if (!arr) {
+                return true;
+            }
+
+            for (rapidjson::SizeType bi = 0; bi < arr->Size(); ++bi) {
+                const json &b = (*arr)[bi];
+                size_t length = get_size(b, "byteLength", 0);
+                gltf_buffer buffer;
+
+                if (!b.IsObject() || !b.HasMember("uri") || !b["uri"].IsString()) {
+                    /* GLB binary chunk */
+                    buffer = glb_bin;
+                } else {
+                    std::string uri = b["uri"].GetString();
+                    if (uri.compare(0, 5, "data:") == 0) {
+                        size_t comma = uri.find(";base64,");
+                        storage.decoded.emplace_back();
+                        if (comma == std::string::npos ||
+                            !decode_base64(uri.data() + comma + 8, uri.data() + uri.size(), storage.decoded.back())) {
+                            ERROR("{}: buffer {} has an unsupported data uri", fname, bi);
+                            return false;
+                        }
+                        buffer.data = storage.decoded.back().data();
+                        buffer.size = storage.decoded.back().size();
+                    } else {
+                        std::string path = (fs::path(fname).parent_path() / uri).string();
+                        auto file = std::make_unique<mapped_file>();
+                        if (!file->open(path)) {
+                            ERROR("{}: cannot open buffer {}", fname, path);
+                            return false;
+                        }
+                        buffer.data = file->data();
+                        buffer.size = file->size();
+                        storage.files.push_back(std::move(file));
+                    }
+                }
+
+                if (buffer.size < length) {
+                    ERROR("{}: buffer {} has {} bytes, {} expected", fname, bi, buffer.size, length);
+                    return false;
+                }
+                buffers.push_back(buffer);
+            }
+            return true;
+        }
+
+        int type_comps(const std::string &type) {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2") return 2;
+            if (type == "VEC3") return 3;
+            if (type == "VEC4") return 4;
+            return 0;
+        }
+
+        bool make_accessor(const json &doc, const std::vector<gltf_buffer> &buffers, int ind, accessor_view &out) {
+            const json *acc = get_item(doc, "accessors", ind);
+            if (!acc) {
+                return false;
+            }
+
+            if (acc->HasMember("sparse")) {
+                WARN("Sparse accessor {} is not supported, base values are used", ind);
+            }
+
+            const json *view = get_item(doc, "bufferViews", get_int(*acc, "bufferView", -1));
+            int buffer_ind = view ? get_int(*view, "buffer", -1) : -1;
+            if (buffer_ind < 0 || buffer_ind >= (int)buffers.size()) {
+                return false;
+            }
+
+            out.comp_type  = get_int(*acc, "componentType", 0);
+            out.comps      = (*acc).HasMember("type") && (*acc)["type"].IsString() ? type_comps((*acc)["type"].GetString()) : 0;
+            out.count      = get_size(*acc, "count", 0);
+            out.normalized = (*acc).HasMember("normalized") && (*acc)["normalized"].IsBool() && (*acc)["normalized"].GetBool();
+
+            size_t elem_size = accessor_view::comp_size(out.comp_type) * out.comps;
+            if (elem_size == 0) {
+                return false;
+            }
+
+            size_t offset      = get_size(*view, "byteOffset", 0) + get_size(*acc, "byteOffset", 0);
+            size_t view_length = get_size(*view, "byteLength", 0);
+            out.stride = get_size(*view, "byteStride", elem_size);
+
+            /* Everything read must stay inside the view and the buffer */
+            const gltf_buffer &buffer = buffers[buffer_ind];
+            size_t last = out.count ? out.stride * (out.count - 1) + elem_size : 0;
+            if (get_size(*acc, "byteOffset", 0) + last > view_length || offset + last > buffer.size) {
+                return false;
+            }
+
+            out.data = buffer.data + offset;
+            return true;
+        }
+
+        glm::mat4 node_matrix(const json &node, bool &identity) {
+            identity = true;
+            glm::mat4 ret(1.0f);
+
+            float m[16];
+            if (get_floats(node, "matrix", 16, m)) {
+                /* Column major, same as glm */
+                for (int c = 0; c < 4; ++c) {
+                    for (int r = 0; r < 4; ++r) {
+                        ret[c][r] = m[c * 4 + r];
+                    }
+                }
+                identity = ret == glm::mat4(1.0f);
+                return ret;
+            }
+
+            float t[3], r[4], s[3];
+            if (get_floats(node, "translation", 3, t)) {
+                ret = glm::translate(ret, glm::vec3(t[0], t[1], t[2]));
+                identity = false;
+            }
+            if (get_floats(node, "rotation", 4, r)) {
+                /* glTF stores x, y, z, w */
+                glm::quat q(r[3], r[0], r[1], r[2]);
+                ret = ret * glm::toMat4(q);
+                identity = false;
+            }
+            if (get_floats(node, "scale", 3, s)) {
+                ret = glm::scale(ret, glm::vec3(s[0], s[1], s[2]));
+                identity = false;
+            }
+            return ret;
+        }
+
+        void collect_node(const json &doc, int node_ind, const glm::mat4 &parent, bool parent_identity, int depth, std::vector<gltf_draw> &draws) {
+            const json *node = get_item(doc, "nodes", node_ind);
+            if (!node || depth > 64) {
+                return;
+            }
+
+            bool identity;
+            glm::mat4 local = node_matrix(*node, identity);
+            glm::mat4 world = identity ? parent : (parent_identity ? local : parent * local);
+            identity = identity && parent_identity;
+
+            int mesh_ind = get_int(*node, "mesh", -1);
+            const json *m = get_item(doc, "meshes", mesh_ind);
+            const json *prims = m ? get_array(*m, "primitives") : nullptr;
+            for (int pi = 0; prims && pi < (int)prims->Size(); ++pi) {
+                draws.push_back({mesh_ind, pi, world, identity});
+            }
+
+            const json *children = get_array(*node, "children");
+            for (rapidjson::SizeType ci = 0; children && ci < children->Size(); ++ci) {
+                if ((*children)[ci].IsInt()) {
+                    collect_node(doc, (*children)[ci].GetInt(), world, identity, depth + 1, draws);
+                }
+            }
+        }
+
+        std::vector<gltf_draw> collect_draws(const json &doc) {
+            std::vector<gltf_draw> ret;
+            const json *scene = get_item(doc, "scenes", get_int(doc, "scene", 0));
+            const json *roots = scene ? get_array(*scene, "nodes") : nullptr;
+
+            if (roots) {
+                for (rapidjson::SizeType ni = 0; ni < roots->Size(); ++ni) {
+                    if ((*roots)[ni].IsInt()) {
+                        collect_node(doc, (*roots)[ni].GetInt(), glm::mat4(1.0f), true, 0, ret);
+                    }
+                }
+                return ret;
+            }
+
+            /* No scene, every mesh once */
+            const json *meshes = get_array(doc, "meshes");
+            for (int mi = 0; meshes && mi < (int)meshes->Size(); ++mi) {
+                const json *prims = get_array((*meshes)[(rapidjson::SizeType)mi], "primitives");
+                for (int pi = 0; prims && pi < (int)prims->Size(); ++pi) {
+                    ret.push_back({mi, pi, glm::mat4(1.0f), true});
+                }
+            }
+            return ret;
+        }
+
+        /* Element of the vertex sequence used by corner k of triangle t */
+        size_t corner(int mode, size_t t, int k) {
+            switch (mode) {
+            case mode_strip:
+                /* Odd triangles swap the first two corners to keep the winding */
+                if (k == 2) return t + 2;
+                return (t % 2 == 0) == (k == 0) ? t : t + 1;
+            case mode_fan:
+                return k == 0 ? 0 : t + k;
+            default:
+                return t * 3 + k;
+            }
+        }
+
+        size_t triangle_count(int mode, size_t n) {
+            if (mode == mode_triangles) return n / 3;
+            return n >= 3 ? n - 2 : 0;
+        }
+
+        /* Everything needed to emit one draw */
+        struct draw_source {
+            int mode;
+            accessor_view pos, nor, tex, col, ind;
+            glm::vec3 base_color = glm::vec3(1.0f);
+            size_t first, tri_num;
+        };
+
+        void emit_draw(const gltf_draw &draw, const draw_source &src,
+                       std::vector<glm::vec3> &verts, std::vector<glm::vec3> &norms,
+                       std::vector<glm::vec3> &colors, std::vector<glm::vec2> &uvs) {
+            size_t n = src.tri_num * 3;
+            glm::vec3 *v = verts.data() + src.first;
+            bool indexed = src.ind.valid();
+
+            /* Straight copies from the buffer */
+            bool direct = !indexed && src.mode == mode_triangles;
+            bool direct_pos = direct && draw.identity && src.pos.tight_float(3);
+            bool direct_nor = direct && draw.identity && src.nor.valid() && src.nor.tight_float(3);
+            bool direct_tex = direct && src.tex.valid() && src.tex.tight_float(2);
+
+            if (direct_pos) memcpy(v, src.pos.data, n * sizeof(glm::vec3));
+            if (direct_nor && !norms.empty()) memcpy(&norms[src.first], src.nor.data, n * sizeof(glm::vec3));
+            if (direct_tex && !uvs.empty()) memcpy(&uvs[src.first], src.tex.data, n * sizeof(glm::vec2));
+
+            glm::mat3 normal_mat = glm::transpose(glm::inverse(glm::mat3(draw.world)));
+            long long tri_num = (long long)src.tri_num;
+
+#pragma omp parallel for if(tri_num > 4096)
+            for (long long t = 0; t < tri_num; ++t) {
+                size_t src_ind[3];
+                for (int k = 0; k < 3; ++k) {
+                    size_t e = corner(src.mode, t, k);
+                    src_ind[k] = indexed ? src.ind.index(e) : e;
+                }
+
+                size_t out = t * 3;
+                if (!direct_pos) {
+                    for (int k = 0; k < 3; ++k) {
+                        glm::vec3 p = src.pos.vec3(src_ind[k]);
+                        v[out + k] = draw.identity ? p : glm::vec3(draw.world * glm::vec4(p, 1.0f));
+                    }
+                }
+
+                if (!norms.empty() && !direct_nor) {
+                    for (int k = 0; k < 3; ++k) {
+                        glm::vec3 nor;
+                        if (src.nor.valid()) {
+                            nor = src.nor.vec3(src_ind[k]);
+                            nor = draw.identity ? nor : glm::normalize(normal_mat * nor);
+                        } else {
+                            nor = glm::normalize(glm::cross(v[out + 1] - v[out], v[out + 2] - v[out + 1]));
+                        }
+                        norms[src.first + out + k] = nor;
+                    }
+                }
+
+                if (!uvs.empty() && !direct_tex) {
+                    for (int k = 0; k < 3; ++k) {
+                        uvs[src.first + out + k] = src.tex.valid() ? src.tex.vec2(src_ind[k]) : glm::vec2(0.0f);
+                    }
+                }
+
+                if (!colors.empty()) {
+                    for (int k = 0; k < 3; ++k) {
+                        glm::vec3 c = src.col.valid() ? src.col.vec3(src_ind[k]) : glm::vec3(1.0f);
+                        colors[src.first + out + k] = c * src.base_color;
+                    }
+                }
+            }
+        }
+
+        bool read_glb(const mapped_file &file, const char *&json_text, size_t &json_len, gltf_buffer &bin) {
+            const char *p = file.data();
+            size_t size = file.size();
+            uint32_t header[3];
+            if (size < sizeof(header)) {
+                return false;
+            }
+
+            memcpy(header, p, sizeof(header));
+            if (header[0] != glb_magic || header[1] != 2 || header[2] > size) {
+                return false;
+            }
+
+            /* Chunks: uint32 length, uint32 type, data */
+            json_text = nullptr;
+            for (size_t offset = sizeof(header); offset + 8 <= header[2];) {
+                uint32_t chunk[2];
+                memcpy(chunk, p + offset, sizeof(chunk));
+                offset += sizeof(chunk);
+                if (offset + chunk[0] > header[2]) {
+                    return false;
+                }
+
+                if (chunk[1] == chunk_json && !json_text) {
+                    json_text = p + offset;
+                    json_len  = chunk[0];
+                } else if (chunk[1] == chunk_bin && !bin.data) {
+                    bin.data = p + offset;
+                    bin.size = chunk[0];
+                }
+                offset += chunk[0];
+            }
+            return json_text != nullptr;
+        }
+    }
+
+    bool parse_gltf(const std::string fname,
+                    std::vector<glm::vec3> &verts,
+                    std::vector<glm::vec3> &norms,
+                    std::vector<glm::vec3> &colors,
+                    std::vector<glm::vec2> &uvs,
+                    std::vector<gltf_part> &parts) {
+        verts.clear();
+        norms.clear();
+        colors.clear();
+        uvs.clear();
+        parts.clear();
+
+        mapped_file file;
+        if (!file.open(fname)) {
+            return false;
+        }
+
+        const char *json_text = file.data();
+        size_t json_len = file.size();
+        gltf_buffer glb_bin;
+        if (file.size() >= 4 && memcmp(file.data(), "glTF", 4) == 0) {
+            if (!read_glb(file, json_text, json_len, glb_bin)) {
+                ERROR("{} is not a valid GLB file", fname);
+                return false;
+            }
+        }
+
+        rapidjson::Document doc;
+        doc.Parse(json_text, json_len);
+        if (doc.HasParseError() || !doc.IsObject()) {
+            ERROR("{} has invalid glTF json", fname);
+            return false;
+        }
+
+        gltf_storage storage;
+        std::vector<gltf_buffer> buffers;
+        if (!load_buffers(doc, fname, glb_bin, storage, buffers)) {
+            return false;
+        }
+
+        /* Resolve every draw first so the output is allocated once */
+        std::vector<gltf_draw> draws = collect_draws(doc);
+        std::vector<draw_source> sources;
+        std::vector<gltf_draw> valid_draws;
+        bool has_normal = false, has_uv = false, has_color = false;
+        size_t total = 0;
+
+        for (auto &draw:draws) {
+            const json &mesh_json = *get_item(doc, "meshes", draw.mesh);
+            const json &prim = mesh_json["primitives"][(rapidjson::SizeType)draw.prim];
+            draw_source src;
+            src.mode = get_int(prim, "mode", mode_triangles);
+            if (src.mode != mode_triangles && src.mode != mode_strip && src.mode != mode_fan) {
+                WARN("{}: mesh {} primitive {} is not triangles (mode {}), skipped", fname, draw.mesh, draw.prim, src.mode);
+                continue;
+            }
+
+            const json *attributes = prim.IsObject() && prim.HasMember("attributes") ? &prim["attributes"] : nullptr;
+            if (!attributes || !make_accessor(doc, buffers, get_int(*attributes, "POSITION", -1), src.pos) || src.pos.comps != 3) {
+                ERROR("{}: mesh {} primitive {} has invalid positions", fname, draw.mesh, draw.prim);
+                return false;
+            }
+
+            bool ok = true;
+            if (attributes->HasMember("NORMAL"))     ok &= make_accessor(doc, buffers, get_int(*attributes, "NORMAL", -1), src.nor);
+            if (attributes->HasMember("TEXCOORD_0")) ok &= make_accessor(doc, buffers, get_int(*attributes, "TEXCOORD_0", -1), src.tex);
+            if (attributes->HasMember("COLOR_0"))    ok &= make_accessor(doc, buffers, get_int(*attributes, "COLOR_0", -1), src.col);
+            if (prim.HasMember("indices"))           ok &= make_accessor(doc, buffers, get_int(prim, "indices", -1), src.ind);
+            if (!ok) {
+                ERROR("{}: mesh {} primitive {} has invalid accessors", fname, draw.mesh, draw.prim);
+                return false;
+            }
+
+            /* Every referenced vertex must exist */
+            size_t seq_len = src.ind.valid() ? src.ind.count : src.pos.count;
+            if (src.ind.valid()) {
+                uint32_t max_ind = 0;
+                long long n = (long long)src.ind.count;
+#pragma omp parallel for reduction(max:max_ind) if(n > 65536)
+                for (long long i = 0; i < n; ++i) {
+                    max_ind = std::max(max_ind, src.ind.index(i));
+                }
+                if (n > 0 && max_ind >= src.pos.count) {
+                    ERROR("{}: mesh {} primitive {} has out of range indices", fname, draw.mesh, draw.prim);
+                    return false;
+                }
+            }
+
+            for (const accessor_view *a : {&src.nor, &src.tex, &src.col}) {
+                if (a->valid() && a->count < src.pos.count) {
+                    ERROR("{}: mesh {} primitive {} has short attributes", fname, draw.mesh, draw.prim);
+                    return false;
+                }
+            }
+
+            int material = get_int(prim, "material", -1);
+            const json *mat = get_item(doc, "materials", material);
+            const json *pbr = mat && mat->HasMember("pbrMetallicRoughness") ? &(*mat)["pbrMetallicRoughness"] : nullptr;
+            float base[4];
+            if (pbr && get_floats(*pbr, "baseColorFactor", 4, base)) {
+                src.base_color = glm::vec3(base[0], base[1], base[2]);
+                has_color = true;
+            }
+
+            has_normal |= src.nor.valid();
+            has_uv     |= src.tex.valid();
+            has_color  |= src.col.valid();
+
+            src.first   = total;
+            src.tri_num = triangle_count(src.mode, seq_len);
+            total += src.tri_num * 3;
+
+            std::string name = mesh_json.HasMember("name") && mesh_json["name"].IsString() ? mesh_json["name"].GetString() : fmt::format("mesh_{}", draw.mesh);
+            parts.push_back({fmt::format("{}_{}", name, draw.prim), src.first, src.tri_num * 3, material});
+            sources.push_back(src);
+            valid_draws.push_back(draw);
+        }
+
+        verts.resize(total);
+        if (has_normal) norms.resize(total);
+        if (has_uv) uvs.resize(total);
+        if (has_color) colors.resize(total);
+
+        /* Large primitives parallelize inside, many small ones across */
+        int draw_num = (int)sources.size();
+#pragma omp parallel for schedule(dynamic) if(draw_num > 1)
+        for (int di = 0; di < draw_num; ++di) {
+            emit_draw(valid_draws[di], sources[di], verts, norms, colors, uvs);
+        }
+        return true;
+    }
+}
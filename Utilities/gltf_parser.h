@@ -0,0 +1,41 @@
+/* glTF 2.0 / GLB parser
+ *
+ *  .glb files are memory mapped, the JSON chunk is parsed once and the
+ *  binary chunk is read in place. .gltf files may reference external
+ *  buffers (memory mapped as well) or base64 data uris.
+ *
+ *  Every mesh primitive reachable from the default scene becomes one part of
+ *  the output triangle soup, with its node transform applied. Files without
+ *  scenes output each mesh untransformed. Triangle lists, strips and fans
+ *  are supported, points and lines are skipped.
+ *
+ *  Non-indexed primitives without a transform whose accessors are tightly
+ *  packed floats are copied straight from the buffer, everything else is
+ *  gathered in parallel.
+ *
+ *  Optional channels are only output if at least one primitive has them:
+ *   - normals: missing ones get the face normal
+ *   - uvs (TEXCOORD_0): missing ones get (0,0)
+ *   - colors (COLOR_0 times the material base color): missing ones get the
+ *     material base color
+ * */
+#pragma once
+#include <string>
+#include <vector>
+#include <common.h>
+
+namespace purdue {
+    /* One primitive in the output soup */
+    struct gltf_part {
+        std::string name;
+        size_t first, count;    /* vertex range */
+        int material;           /* -1 if none */
+    };
+
+    bool parse_gltf(const std::string fname,
+                    std::vector<glm::vec3> &verts,
+                    std::vector<glm::vec3> &norms,
+                    std::vector<glm::vec3> &colors,
+                    std::vector<glm::vec2> &uvs,
+                    std::vector<gltf_part> &parts);
+}
@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <cstring>
+
+#include "image_dataset.h"
+#include "Utils.h"
+#include "Logger.h"
+
+namespace {
+    const char shard_magic[8] = {'G', 'L', 'S', 'H', 'A', 'R', 'D', '1'};
+    const uint32_t shard_version = 1;
+    const uint64_t record_alignment = 64;
+
+    struct shard_footer {
+        uint64_t index_offset;
+        uint32_t record_num;
+        uint32_t version;
+        char magic[8];
+    };
+    static_assert(sizeof(shard_footer) == 24, "shard footer should be 24 bytes");
+
+    size_t dtype_bytes(dataset_dtype dtype) {
+        return dtype == dataset_dtype::u8 ? 1 : 4;
+    }
+}
+
+/* One footer index entry */
+struct dataset_record_entry {
+    int64_t  id;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+    uint64_t meta_offset;
+    uint32_t meta_bytes;
+    uint32_t w, h, c;
+    uint32_t dtype;
+    uint32_t padding[3];
+};
+static_assert(sizeof(dataset_record_entry) == 64, "record entry should be 64 bytes");
+
+
+//------- Record View --------//
+const float* image_record::pixels() const {
+    return dtype == dataset_dtype::f32 ? static_cast<const float*>(data) : nullptr;
+}
+
+const unsigned char* image_record::bytes() const {
+    return dtype == dataset_dtype::u8 ? static_cast<const unsigned char*>(data) : nullptr;
+}
+
+static glm::vec4 record_pixel(const image_record &r, size_t ind) {
+    glm::vec4 ret(0.0f, 0.0f, 0.0f, 1.0f);
+    int c = std::min(r.c, 4);
+    if (r.dtype == dataset_dtype::f32) {
+        const float *p = r.pixels() + ind * r.c;
+        for (int ci = 0; ci < c; ++ci) ret[ci] = p[ci];
+    } else {
+        const unsigned char *p = r.bytes() + ind * r.c;
+        for (int ci = 0; ci < c; ++ci) ret[ci] = p[ci] / 255.0f;
+    }
+    return ret;
+}
+
+glm::vec4 image_record::get(int i, int j) const {
+    FAIL(i < 0 || i >= w || j < 0 || j >= h, "Record index error: {} {} ({},{})", i, j, w, h);
+    return record_pixel(*this, (size_t)j * w + i);
+}
+
+std::string image_record::metadata() const {
+    return std::string(meta, meta_bytes);
+}
+
+Image image_record::to_image() const {
+    Image ret(w, h);
+    glm::vec4 *dst = ret.data();
+
+    /* Straight copy for RGBA float records */
+    if (dtype == dataset_dtype::f32 && c == 4) {
+        memcpy(dst, data, (size_t)w * h * sizeof(glm::vec4));
+        return ret;
+    }
+
+#pragma omp parallel for
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            size_t ind = (size_t)j * w + i;
+            dst[ind] = record_pixel(*this, ind);
+        }
+    }
+    return ret;
+}
+
+
+//------- Writer --------//
+image_dataset_writer::image_dataset_writer(const std::string prefix, size_t shard_bytes):
+    m_prefix(prefix),
+    m_shard_bytes(shard_bytes) {
+    /* The reader scans shards until the first missing one, shards left by an
+     * older and longer dataset with the same prefix would be read back */
+    for (int shard = 0; ; ++shard) {
+        std::string fname = shard_name(m_prefix, shard);
+        if (!purdue::file_exists(fname)) {
+            break;
+        }
+
+        boost::system::error_code ec;
+        fs::remove(fname, ec);
+        if (ec) {
+            WARN("Cannot remove stale shard {}", fname);
+            break;
+        }
+    }
+}
+
+image_dataset_writer::~image_dataset_writer() {
+    close();
+}
+
+std::string image_dataset_writer::shard_name(const std::string prefix, int shard) {
+    return fmt::format("{}_{:05d}.shard", prefix, shard);
+}
+
+int64_t image_dataset_writer::append(const Image &img, const std::string meta) {
+    return append(reinterpret_cast<const float*>(img.data()), img.width(), img.height(), 4, meta);
+}
+
+int64_t image_dataset_writer::append(const float *data, int w, int h, int c, const std::string meta) {
+    return append_record(data, (size_t)w * h * c * sizeof(float), w, h, c, dataset_dtype::f32, meta);
+}
+
+int64_t image_dataset_writer::append(const unsigned char *data, int w, int h, int c, const std::string meta) {
+    return append_record(data, (size_t)w * h * c, w, h, c, dataset_dtype::u8, meta);
+}
+
+size_t image_dataset_writer::size() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return (size_t)m_next_id;
+}
+
+int64_t image_dataset_writer::append_record(const void *data, size_t data_bytes, int w, int h, int c, dataset_dtype dtype, const std::string &meta) {
+    if (data == nullptr || w <= 0 || h <= 0 || c <= 0) {
+        ERROR("Dataset record is invalid ({}x{}x{})", w, h, c);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_closed) {
+        ERROR("Dataset {} is already closed", m_prefix);
+        return -1;
+    }
+
+    uint64_t aligned = (m_offset + record_alignment - 1) / record_alignment * record_alignment;
+    uint64_t record_end = aligned + data_bytes + meta.size();
+
+    /* Start a new shard if this record overflows the current one. A single
+     * record larger than a shard gets a shard of its own. */
+    bool overflow = m_shard >= 0 && !m_entries.empty() && record_end > m_shard_bytes;
+    if (m_shard < 0 || overflow) {
+        if (!close_shard() || !open_shard()) {
+            return -1;
+        }
+        aligned = 0;
+    }
+
+    static const char zeros[record_alignment] = {0};
+    m_output.write(zeros, aligned - m_offset);
+    m_output.write(static_cast<const char*>(data), data_bytes);
+    m_output.write(meta.data(), meta.size());
+    if (!m_output.good()) {
+        ERROR("Writing {} failed", shard_name(m_prefix, m_shard));
+        return -1;
+    }
+
+    dataset_record_entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.id          = m_next_id++;
+    entry.data_offset = aligned;
+    entry.data_bytes  = data_bytes;
+    entry.meta_offset = aligned + data_bytes;
+    entry.meta_bytes  = (uint32_t)meta.size();
+    entry.w           = w;
+    entry.h           = h;
+    entry.c           = c;
+    entry.dtype       = (uint32_t)dtype;
+    m_entries.push_back(entry);
+
+    m_offset = aligned + data_bytes + meta.size();
+    return entry.id;
+}
+
+bool image_dataset_writer::open_shard() {
+    ++m_shard;
+    std::string fname = shard_name(m_prefix, m_shard);
+    m_output.open(fname, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_output.is_open()) {
+        ERROR("Cannot open {}", fname);
+        return false;
+    }
+
+    m_offset = 0;
+    m_entries.clear();
+    return true;
+}
+
+bool image_dataset_writer::close_shard() {
+    if (!m_output.is_open()) {
+        return true;
+    }
+
+    shard_footer footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.index_offset = m_offset;
+    footer.record_num   = (uint32_t)m_entries.size();
+    footer.version      = shard_version;
+    memcpy(footer.magic, shard_magic, sizeof(shard_magic));
+
+    m_output.write(reinterpret_cast<const char*>(m_entries.data()), sizeof(dataset_record_entry) * m_entries.size());
+    m_output.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+
+    bool ret = m_output.good();
+    m_output.close();
+    m_entries.clear();
+
+    if (!ret) {
+        ERROR("Writing footer of {} failed", shard_name(m_prefix, m_shard));
+    }
+    return ret;
+}
+
+bool image_dataset_writer::close() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_closed) {
+        return true;
+    }
+
+    m_closed = true;
+    return close_shard();
+}
+
+
+//------- Reader --------//
+image_dataset_reader::image_dataset_reader(const std::string prefix) {
+    open(prefix);
+}
+
+bool image_dataset_reader::open(const std::string prefix) {
+    m_shards.clear();
+    m_records.clear();
+
+    bool ret = true;
+    for (int shard = 0; ; ++shard) {
+        std::string fname = image_dataset_writer::shard_name(prefix, shard);
+        if (!purdue::file_exists(fname)) {
+            break;
+        }
+
+        auto cur_shard = std::make_unique<mapped_file>();
+        if (!cur_shard->open(fname) || !parse_shard(*cur_shard)) {
+            WARN("Skip broken shard {}", fname);
+            ret = false;
+            continue;
+        }
+
+        cur_shard->advise_random();
+        m_shards.push_back(std::move(cur_shard));
+    }
+
+    std::sort(m_records.begin(), m_records.end(), [](const image_record &a, const image_record &b) {
+        return a.id < b.id;
+    });
+
+    if (m_shards.empty()) {
+        WARN("Cannot find any shard of {}", prefix);
+        return false;
+    }
+    return ret;
+}
+
+bool image_dataset_reader::parse_shard(const mapped_file &shard) {
+    const char *base = shard.data();
+    size_t size = shard.size();
+    if (size < sizeof(shard_footer)) {
+        return false;
+    }
+
+    shard_footer footer;
+    memcpy(&footer, base + size - sizeof(footer), sizeof(footer));
+    if (memcmp(footer.magic, shard_magic, sizeof(shard_magic)) != 0 || footer.version != shard_version) {
+        return false;
+    }
+
+    uint64_t index_bytes = (uint64_t)footer.record_num * sizeof(dataset_record_entry);
+    if (footer.index_offset + index_bytes + sizeof(footer) != size) {
+        return false;
+    }
+
+    std::vector<image_record> records(footer.record_num);
+    for (uint32_t ri = 0; ri < footer.record_num; ++ri) {
+        dataset_record_entry entry;
+        memcpy(&entry, base + footer.index_offset + ri * sizeof(dataset_record_entry), sizeof(entry));
+
+        /* Unknown (corrupt or newer) dtypes have no pixel accessor */
+        if (entry.dtype != (uint32_t)dataset_dtype::f32 && entry.dtype != (uint32_t)dataset_dtype::u8) {
+            return false;
+        }
+
+        dataset_dtype dtype = (dataset_dtype)entry.dtype;
+        uint64_t expected = (uint64_t)entry.w * entry.h * entry.c * dtype_bytes(dtype);
+        if (entry.data_bytes != expected ||
+            entry.data_offset + entry.data_bytes > footer.index_offset ||
+            entry.meta_offset + entry.meta_bytes > footer.index_offset) {
+            return false;
+        }
+
+        image_record &record = records[ri];
+        record.id         = entry.id;
+        record.w          = entry.w;
+        record.h          = entry.h;
+        record.c          = entry.c;
+        record.dtype      = dtype;
+        record.data       = base + entry.data_offset;
+        record.meta       = base + entry.meta_offset;
+        record.meta_bytes = entry.meta_bytes;
+    }
+
+    m_records.insert(m_records.end(), records.begin(), records.end());
+    return true;
+}
+
+const image_record& image_dataset_reader::get(size_t ind) const {
+    FAIL(ind >= m_records.size(), "Record index {} out of range({})", ind, m_records.size());
+    return m_records[ind];
+}
+
+bool image_dataset_reader::find(int64_t id, image_record &out) const {
+    auto it = std::lower_bound(m_records.begin(), m_records.end(), id, [](const image_record &r, int64_t id) {
+        return r.id < id;
+    });
+
+    if (it == m_records.end() || it->id != id) {
+        return false;
+    }
+
+    out = *it;
+    return true;
+}
@@ -0,0 +1,90 @@
+/* Sharded image dataset container
+ *
+ *  Records are appended to fixed-size shard files <prefix>_<shard>.shard.
+ *  Every shard ends with a footer index (offsets, shapes, dtypes and the
+ *  per-record metadata blob). The reader maps the shards and hands out
+ *  zero-copy views of the records.
+ * */
+#pragma once
+#include <common.h>
+#include <mutex>
+#include <cstdint>
+#include "mapped_file.h"
+
+struct dataset_record_entry;
+
+enum class dataset_dtype : uint32_t {
+    f32 = 0,
+    u8  = 1
+};
+
+/* View of one record inside a mapped shard, valid while the reader lives */
+struct image_record {
+    int64_t id = -1;
+    int w = 0, h = 0, c = 0;
+    dataset_dtype dtype = dataset_dtype::f32;
+    const void *data = nullptr;
+    const char *meta = nullptr;
+    size_t meta_bytes = 0;
+
+    const float* pixels() const;            /* nullptr if dtype is not f32 */
+    const unsigned char* bytes() const;     /* nullptr if dtype is not u8 */
+    glm::vec4 get(int i, int j) const;
+    std::string metadata() const;
+    Image to_image() const;
+};
+
+class image_dataset_writer {
+public:
+    /* Shards already written with this prefix are removed */
+    image_dataset_writer(const std::string prefix, size_t shard_bytes=(size_t)1 << 30);
+    ~image_dataset_writer();
+
+    /* Thread safe. Return the record id, -1 if failed */
+    int64_t append(const Image &img, const std::string meta="");
+    int64_t append(const float *data, int w, int h, int c, const std::string meta="");
+    int64_t append(const unsigned char *data, int w, int h, int c, const std::string meta="");
+
+    /* Write the footer of the last shard. Called by the destructor */
+    bool close();
+    size_t size();
+
+    static std::string shard_name(const std::string prefix, int shard);
+
+private:
+    int64_t append_record(const void *data, size_t data_bytes, int w, int h, int c, dataset_dtype dtype, const std::string &meta);
+    bool open_shard();
+    bool close_shard();
+
+private:
+    std::string m_prefix;
+    size_t m_shard_bytes;
+    std::mutex m_lock;
+
+    int m_shard = -1;
+    int64_t m_next_id = 0;
+    uint64_t m_offset = 0;
+    std::ofstream m_output;
+    std::vector<dataset_record_entry> m_entries;
+    bool m_closed = false;
+};
+
+class image_dataset_reader {
+public:
+    image_dataset_reader() = default;
+    image_dataset_reader(const std::string prefix);
+
+    bool open(const std::string prefix);
+    size_t size() const { return m_records.size(); }
+
+    /* Records are ordered by id */
+    const image_record& get(size_t ind) const;
+    bool find(int64_t id, image_record &out) const;
+
+private:
+    bool parse_shard(const mapped_file &shard);
+
+private:
+    std::vector<std::unique_ptr<mapped_file>> m_shards;
+    std::vector<image_record> m_records;
+};
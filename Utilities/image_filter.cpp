@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cmath>
+
+#include "image_filter.h"
+#include "Logger.h"
+
+//------- Summed Area Table --------//
+summed_area_table::summed_area_table(): m_w(0), m_h(0) {
+}
+
+summed_area_table::summed_area_table(const Image &img) {
+    build(img);
+}
+
+void summed_area_table::build(const Image &img) {
+    m_w = img.width();
+    m_h = img.height();
+    m_table.assign((size_t)(m_w + 1) * (m_h + 1), glm::dvec4(0.0));
+
+    const glm::vec4 *src = img.data();
+
+    /* Row prefix sums, rows are independent */
+#pragma omp parallel for
+    for (int j = 0; j < m_h; ++j) {
+        glm::dvec4 acc(0.0);
+        glm::dvec4 *row = &m_table[ind(1, j + 1)];
+        const glm::vec4 *src_row = src + (size_t)j * m_w;
+        for (int i = 0; i < m_w; ++i) {
+            acc += glm::dvec4(src_row[i]);
+            row[i] = acc;
+        }
+    }
+
+    /* Column prefix sums, walked row by row over column blocks so memory is read contiguously */
+    const int block = 64;
+    int block_num = (m_w + block - 1) / block;
+#pragma omp parallel for
+    for (int b = 0; b < block_num; ++b) {
+        int i0 = 1 + b * block, i1 = std::min(m_w + 1, i0 + block);
+        for (int j = 2; j <= m_h; ++j) {
+            glm::dvec4 *row = &m_table[ind(0, j)];
+            const glm::dvec4 *prev = &m_table[ind(0, j - 1)];
+            for (int i = i0; i < i1; ++i) {
+                row[i] += prev[i];
+            }
+        }
+    }
+}
+
+glm::dvec4 summed_area_table::sum(int x0, int y0, int x1, int y1) const {
+    x0 = std::max(x0, 0); y0 = std::max(y0, 0);
+    x1 = std::min(x1, m_w - 1); y1 = std::min(y1, m_h - 1);
+    if (x0 > x1 || y0 > y1) {
+        return glm::dvec4(0.0);
+    }
+
+    return m_table[ind(x1 + 1, y1 + 1)] - m_table[ind(x0, y1 + 1)]
+         - m_table[ind(x1 + 1, y0)] + m_table[ind(x0, y0)];
+}
+
+glm::vec4 summed_area_table::mean(int x0, int y0, int x1, int y1) const {
+    x0 = std::max(x0, 0); y0 = std::max(y0, 0);
+    x1 = std::min(x1, m_w - 1); y1 = std::min(y1, m_h - 1);
+    if (x0 > x1 || y0 > y1) {
+        return glm::vec4(0.0f);
+    }
+
+    double area = (double)(x1 - x0 + 1) * (y1 - y0 + 1);
+    return glm::vec4(sum(x0, y0, x1, y1) / area);
+}
+
+
+//------- Filters --------//
+namespace purdue {
+    namespace {
+        /* Radius of box pass p, the iterated boxes approximate a Gaussian of sigma
+         * (W. Jarosz, Fast image convolutions) */
+        int gauss_box_radius(float sigma, int passes, int p) {
+            if (sigma <= 0.0f) {
+                return 0;
+            }
+
+            double var = 12.0 * sigma * sigma;
+            int wl = (int)std::floor(std::sqrt(var / passes + 1.0));
+            if (wl % 2 == 0) wl--;
+            int wu = wl + 2;
+
+            int m = (int)std::round((var - passes * wl * wl - 4.0 * passes * wl - 3.0 * passes) / (-4.0 * wl - 4.0));
+            return ((p < m ? wl : wu) - 1) / 2;
+        }
+
+        bool check_map(const Image &img, const Image &map) {
+            if (img.width() != map.width() || img.height() != map.height()) {
+                ERROR("Filter map size ({},{}) does not match image ({},{})", map.width(), map.height(), img.width(), img.height());
+                return false;
+            }
+            return true;
+        }
+
+        template<typename F>
+        Image box_pass(const Image &img, const summed_area_table &sat, F radius) {
+            int w = img.width(), h = img.height();
+            Image ret(w, h);
+            glm::vec4 *dst = ret.data();
+
+#pragma omp parallel for
+            for (int j = 0; j < h; ++j) {
+                for (int i = 0; i < w; ++i) {
+                    dst[(size_t)j * w + i] = sat.box(i, j, radius(i, j));
+                }
+            }
+            return ret;
+        }
+    }
+
+    Image box_filter(const Image &img, int radius) {
+        if (radius <= 0) {
+            return img;
+        }
+
+        summed_area_table sat(img);
+        return box_pass(img, sat, [&](int, int) { return radius; });
+    }
+
+    Image box_filter(const Image &img, const Image &radius_map, float scale) {
+        if (!check_map(img, radius_map)) {
+            return img;
+        }
+
+        const glm::vec4 *r = radius_map.data();
+        int w = img.width();
+        summed_area_table sat(img);
+        return box_pass(img, sat, [&](int i, int j) {
+            return std::max(0, (int)std::round(r[(size_t)j * w + i].r * scale));
+        });
+    }
+
+    Image gaussian_blur(const Image &img, float sigma, int passes) {
+        passes = std::max(passes, 1);
+
+        Image ret = img;
+        summed_area_table sat;
+        for (int p = 0; p < passes; ++p) {
+            int radius = gauss_box_radius(sigma, passes, p);
+            if (radius <= 0) {
+                continue;
+            }
+
+            sat.build(ret);
+            ret = box_pass(ret, sat, [&](int, int) { return radius; });
+        }
+        return ret;
+    }
+
+    Image gaussian_blur(const Image &img, const Image &sigma_map, float scale, int passes) {
+        if (!check_map(img, sigma_map)) {
+            return img;
+        }
+        passes = std::max(passes, 1);
+
+        int w = img.width();
+        const glm::vec4 *s = sigma_map.data();
+        Image ret = img;
+        summed_area_table sat;
+        for (int p = 0; p < passes; ++p) {
+            sat.build(ret);
+            ret = box_pass(ret, sat, [&](int i, int j) { return gauss_box_radius(s[(size_t)j * w + i].r * scale, passes, p); });
+        }
+        return ret;
+    }
+}
@@ -0,0 +1,50 @@
+/* Integral image and box based filters
+ *
+ *  summed_area_table keeps prefix sums in double so large images do not lose
+ *  precision. Every box query is O(1), filters below cost the same per pixel
+ *  whatever the radius is. Windows are clipped at the image border and
+ *  normalized by the clipped area.
+ * */
+#pragma once
+#include <common.h>
+
+class summed_area_table {
+public:
+    summed_area_table();
+    summed_area_table(const Image &img);
+    ~summed_area_table()=default;
+
+    void build(const Image &img);
+
+    int width() const { return m_w; }
+    int height() const { return m_h; }
+
+    /* Sum / mean over the inclusive window [x0,x1]x[y0,y1], clipped to the image */
+    glm::dvec4 sum(int x0, int y0, int x1, int y1) const;
+    glm::vec4 mean(int x0, int y0, int x1, int y1) const;
+
+    /* Mean of the (2r+1)^2 window centred at (i, j) */
+    glm::vec4 box(int i, int j, int r) const { return mean(i - r, j - r, i + r, j + r); }
+
+private:
+    /* (w+1) x (h+1), first row and column are zero */
+    size_t ind(int i, int j) const { return (size_t)j * (m_w + 1) + i; }
+
+private:
+    int m_w, m_h;
+    std::vector<glm::dvec4> m_table;
+};
+
+namespace purdue {
+    /* Fixed radius box filter */
+    Image box_filter(const Image &img, int radius);
+
+    /* Per pixel radius: radius_map.r * scale, rounded. radius_map has the same size as img */
+    Image box_filter(const Image &img, const Image &radius_map, float scale=1.0f);
+
+    /* Gaussian approximated by passes iterated boxes */
+    Image gaussian_blur(const Image &img, float sigma, int passes=3);
+
+    /* Per pixel sigma: sigma_map.r * scale, e.g. a penumbra width map for soft shadows */
+    Image gaussian_blur(const Image &img, const Image &sigma_map, float scale=1.0f, int passes=3);
+}
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "image_metrics.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        const int ssim_radius = 5;
+        const float ssim_sigma = 1.5f;
+
+        void check_dim(const Image &a, const Image &b) {
+            FAIL(a.width() != b.width() || a.height() != b.height(), "Image metric, dim does not match! {},{} but rhs {},{}", a.width(), a.height(), b.width(), b.height());
+        }
+
+        double to_psnr(double mse, float peak) {
+            if (mse <= 0.0) {
+                return std::numeric_limits<double>::infinity();
+            }
+            return 10.0 * std::log10((double)peak * peak / mse);
+        }
+
+        /* Horizontally filtered moments of one pixel */
+        struct ssim_moments {
+            glm::vec3 a, b, aa, bb, ab;
+        };
+    }
+
+    image_diff_stats compare(const Image &a, const Image &b, float peak) {
+        check_dim(a, b);
+
+        const glm::vec4 *pa = a.data(), *pb = b.data();
+        long long n = (long long)a.width() * a.height();
+        double sqr_sum = 0.0;
+        float max_abs = 0.0f;
+
+#pragma omp parallel for simd reduction(+:sqr_sum) reduction(max:max_abs)
+        for (long long i = 0; i < n; ++i) {
+            float dr = pa[i].r - pb[i].r, dg = pa[i].g - pb[i].g, db = pa[i].b - pb[i].b;
+            sqr_sum += dr * dr + dg * dg + db * db;
+            max_abs = std::max(max_abs, std::max(std::abs(dr), std::max(std::abs(dg), std::abs(db))));
+        }
+
+        image_diff_stats ret;
+        ret.mse     = n > 0 ? sqr_sum / (3.0 * n) : 0.0;
+        ret.psnr    = to_psnr(ret.mse, peak);
+        ret.max_abs = max_abs;
+        return ret;
+    }
+
+    double mse(const Image &a, const Image &b) {
+        return compare(a, b).mse;
+    }
+
+    double psnr(const Image &a, const Image &b, float peak) {
+        return compare(a, b, peak).psnr;
+    }
+
+    float max_abs_error(const Image &a, const Image &b) {
+        return compare(a, b).max_abs;
+    }
+
+    double ssim(const Image &a, const Image &b, float peak) {
+        check_dim(a, b);
+
+        int w = a.width(), h = a.height();
+        if (w == 0 || h == 0) {
+            return 1.0;
+        }
+
+        float kernel[2 * ssim_radius + 1];
+        for (int k = -ssim_radius; k <= ssim_radius; ++k) {
+            kernel[k + ssim_radius] = std::exp(-0.5f * k * k / (ssim_sigma * ssim_sigma));
+        }
+
+        const glm::vec4 *pa = a.data(), *pb = b.data();
+
+        /* Horizontal pass, windows are clipped at the border and renormalized */
+        std::vector<ssim_moments> tmp((size_t)w * h);
+#pragma omp parallel for
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i) {
+                ssim_moments m = {glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f)};
+                float wsum = 0.0f;
+                int x0 = std::max(0, i - ssim_radius), x1 = std::min(w - 1, i + ssim_radius);
+                for (int x = x0; x <= x1; ++x) {
+                    float k = kernel[x - i + ssim_radius];
+                    glm::vec3 va(pa[(size_t)j * w + x]), vb(pb[(size_t)j * w + x]);
+                    m.a  += k * va;
+                    m.b  += k * vb;
+                    m.aa += k * va * va;
+                    m.bb += k * vb * vb;
+                    m.ab += k * va * vb;
+                    wsum += k;
+                }
+
+                float inv = 1.0f / wsum;
+                tmp[(size_t)j * w + i] = {m.a * inv, m.b * inv, m.aa * inv, m.bb * inv, m.ab * inv};
+            }
+        }
+
+        /* Vertical pass, SSIM map is reduced on the fly */
+        const float c1 = (0.01f * peak) * (0.01f * peak);
+        const float c2 = (0.03f * peak) * (0.03f * peak);
+        double total = 0.0;
+
+#pragma omp parallel for reduction(+:total)
+        for (int j = 0; j < h; ++j) {
+            int y0 = std::max(0, j - ssim_radius), y1 = std::min(h - 1, j + ssim_radius);
+            double row_total = 0.0;
+            for (int i = 0; i < w; ++i) {
+                ssim_moments m = {glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f)};
+                float wsum = 0.0f;
+                for (int y = y0; y <= y1; ++y) {
+                    float k = kernel[y - j + ssim_radius];
+                    const ssim_moments &t = tmp[(size_t)y * w + i];
+                    m.a  += k * t.a;
+                    m.b  += k * t.b;
+                    m.aa += k * t.aa;
+                    m.bb += k * t.bb;
+                    m.ab += k * t.ab;
+                    wsum += k;
+                }
+
+                float inv = 1.0f / wsum;
+                glm::vec3 mu_a = m.a * inv, mu_b = m.b * inv;
+                glm::vec3 var_a = m.aa * inv - mu_a * mu_a;
+                glm::vec3 var_b = m.bb * inv - mu_b * mu_b;
+                glm::vec3 cov   = m.ab * inv - mu_a * mu_b;
+
+                for (int c = 0; c < 3; ++c) {
+                    float num = (2.0f * mu_a[c] * mu_b[c] + c1) * (2.0f * cov[c] + c2);
+                    float den = (mu_a[c] * mu_a[c] + mu_b[c] * mu_b[c] + c1) * (var_a[c] + var_b[c] + c2);
+                    row_total += num / den;
+                }
+            }
+            total += row_total;
+        }
+
+        return total / (3.0 * w * h);
+    }
+
+    float percentile_error(const Image &a, const Image &b, float p) {
+        check_dim(a, b);
+
+        const glm::vec4 *pa = a.data(), *pb = b.data();
+        long long n = (long long)a.width() * a.height();
+        if (n == 0) {
+            return 0.0f;
+        }
+
+        std::vector<float> err(n);
+#pragma omp parallel for simd
+        for (long long i = 0; i < n; ++i) {
+            float dr = std::abs(pa[i].r - pb[i].r), dg = std::abs(pa[i].g - pb[i].g), db = std::abs(pa[i].b - pb[i].b);
+            err[i] = std::max(dr, std::max(dg, db));
+        }
+
+        p = std::min(std::max(p, 0.0f), 100.0f);
+        size_t k = (size_t)std::round(p / 100.0f * (n - 1));
+        std::nth_element(err.begin(), err.begin() + k, err.end());
+        return err[k];
+    }
+
+    Image error_heatmap(const Image &a, const Image &b, int tile_size) {
+        check_dim(a, b);
+        tile_size = std::max(tile_size, 1);
+
+        int w = a.width(), h = a.height();
+        int tiles_x = (w + tile_size - 1) / tile_size;
+        int tiles_y = (h + tile_size - 1) / tile_size;
+        const glm::vec4 *pa = a.data(), *pb = b.data();
+
+        Image ret(tiles_x, tiles_y);
+        glm::vec4 *dst = ret.data();
+
+#pragma omp parallel for schedule(dynamic)
+        for (int t = 0; t < tiles_x * tiles_y; ++t) {
+            int x0 = (t % tiles_x) * tile_size, y0 = (t / tiles_x) * tile_size;
+            int x1 = std::min(w, x0 + tile_size), y1 = std::min(h, y0 + tile_size);
+
+            glm::vec3 sqr_sum(0.0f);
+            for (int j = y0; j < y1; ++j) {
+                for (int i = x0; i < x1; ++i) {
+                    size_t ind = (size_t)j * w + i;
+                    glm::vec3 d = glm::vec3(pa[ind]) - glm::vec3(pb[ind]);
+                    sqr_sum += d * d;
+                }
+            }
+
+            float area = (float)(x1 - x0) * (y1 - y0);
+            dst[t] = glm::vec4(sqr_sum / area, 1.0f);
+        }
+        return ret;
+    }
+}
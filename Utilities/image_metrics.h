@@ -0,0 +1,32 @@
+/* Image quality metrics for render comparisons and regressions
+ *
+ *  All metrics are over rgb, alpha is ignored. Pixel values are expected in
+ *  [0, peak]. Every metric is one parallel pass over both images;
+ *  SSIM needs one temporary (horizontally filtered moments).
+ * */
+#pragma once
+#include <common.h>
+
+struct image_diff_stats {
+    double mse;
+    double psnr;        /* dB, infinity for identical images */
+    float max_abs;
+};
+
+namespace purdue {
+    double mse(const Image &a, const Image &b);
+    double psnr(const Image &a, const Image &b, float peak=1.0f);
+    float max_abs_error(const Image &a, const Image &b);
+
+    /* MSE, PSNR and max abs in one pass */
+    image_diff_stats compare(const Image &a, const Image &b, float peak=1.0f);
+
+    /* Mean SSIM, 11x11 separable Gaussian window (sigma 1.5), averaged over rgb */
+    double ssim(const Image &a, const Image &b, float peak=1.0f);
+
+    /* Error at percentile p in [0, 100] of the per-pixel max channel abs error */
+    float percentile_error(const Image &a, const Image &b, float p);
+
+    /* One pixel per tile holding the tile's MSE in rgb (per channel), alpha 1 */
+    Image error_heatmap(const Image &a, const Image &b, int tile_size=32);
+}
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "image_writer.h"
+#include "Logger.h"
+
+#ifdef GRAPHICS_LIB_ZSTD
+#include <zstd.h>
+#endif
+
+namespace purdue {
+    namespace {
+        const char raw_magic[8]  = {'G', 'L', 'R', 'A', 'W', 'F', '3', '2'};
+        const char tile_magic[8] = {'G', 'L', 'T', 'I', 'L', 'E', '3', '2'};
+        const uint32_t writer_version = 1;
+
+        struct tile_header {
+            char magic[8];
+            uint32_t version;
+            uint32_t w, h, c;
+            uint32_t tile_size;
+            uint32_t compression;
+            uint32_t tiles_x, tiles_y;
+            char padding[24];
+        };
+        static_assert(sizeof(tile_header) == 64, "tile header should be 64 bytes");
+
+        struct tile_entry {
+            uint64_t offset;
+            uint64_t bytes;
+        };
+
+        bool check_input(const std::string &fname, const float *data, int w, int h, int c) {
+            if (data == nullptr || w <= 0 || h <= 0 || c <= 0) {
+                ERROR("Cannot save {}: invalid buffer ({}x{}x{})", fname, w, h, c);
+                return false;
+            }
+            return true;
+        }
+
+        /* Pixel data is written with one call so large frames go to the kernel in one piece */
+        bool write_file(const std::string &fname, const char *header, size_t header_bytes, const float *data, size_t data_bytes) {
+            std::ofstream output(fname, std::ios::out | std::ios::binary);
+            if (!output.is_open()) {
+                ERROR("Cannot open {}", fname);
+                return false;
+            }
+
+            output.write(header, header_bytes);
+            output.write(reinterpret_cast<const char*>(data), data_bytes);
+            if (!output.good()) {
+                ERROR("Writing {} failed", fname);
+                return false;
+            }
+            return true;
+        }
+    }
+
+    bool tile_compression_available(tile_compression comp) {
+        switch (comp) {
+        case tile_compression::none:
+            return true;
+        case tile_compression::zstd:
+#ifdef GRAPHICS_LIB_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    bool save_npy(const std::string fname, const float *data, int w, int h, int c) {
+        if (!check_input(fname, data, w, h, c)) {
+            return false;
+        }
+
+        /* NPY v1.0: magic, version, uint16 header length, python dict padded to 64 bytes */
+        std::string dict = fmt::format("{{'descr': '<f4', 'fortran_order': False, 'shape': ({}, {}, {}), }}", h, w, c);
+        const size_t preamble = 10;
+        size_t total = preamble + dict.size() + 1;
+        size_t padded = (total + 63) / 64 * 64;
+        dict.append(padded - total, ' ');
+        dict.push_back('\n');
+
+        std::string header = "\x93NUMPY";
+        header.push_back('\x01');
+        header.push_back('\x00');
+        uint16_t dict_len = (uint16_t)dict.size();
+        header.push_back((char)(dict_len & 0xff));
+        header.push_back((char)(dict_len >> 8));
+        header += dict;
+
+        size_t data_bytes = (size_t)w * h * c * sizeof(float);
+        return write_file(fname, header.data(), header.size(), data, data_bytes);
+    }
+
+    bool save_raw(const std::string fname, const float *data, int w, int h, int c) {
+        if (!check_input(fname, data, w, h, c)) {
+            return false;
+        }
+
+        char header[raw_header_size];
+        memset(header, 0, sizeof(header));
+        uint32_t fields[4] = {writer_version, (uint32_t)w, (uint32_t)h, (uint32_t)c};
+        memcpy(header, raw_magic, sizeof(raw_magic));
+        memcpy(header + sizeof(raw_magic), fields, sizeof(fields));
+
+        size_t data_bytes = (size_t)w * h * c * sizeof(float);
+        return write_file(fname, header, sizeof(header), data, data_bytes);
+    }
+
+    bool save_float_tiles(const std::string fname, const float *data, int w, int h, int c, int tile_size, tile_compression comp) {
+        if (!check_input(fname, data, w, h, c)) {
+            return false;
+        }
+
+        if (tile_size <= 0) {
+            ERROR("Tile size {} is invalid", tile_size);
+            return false;
+        }
+
+        if (!tile_compression_available(comp)) {
+            WARN("Tile compression {} is not built in, tiles are stored uncompressed", (uint32_t)comp);
+            comp = tile_compression::none;
+        }
+
+        int tiles_x = (w + tile_size - 1) / tile_size;
+        int tiles_y = (h + tile_size - 1) / tile_size;
+        int tile_num = tiles_x * tiles_y;
+
+        std::vector<std::vector<char>> payloads(tile_num);
+        std::atomic<bool> failed(false);
+
+        /* Gather (and compress) every tile independently */
+#pragma omp parallel for schedule(dynamic)
+        for (int ti = 0; ti < tile_num; ++ti) {
+            int x0 = (ti % tiles_x) * tile_size, y0 = (ti / tiles_x) * tile_size;
+            int tw = std::min(tile_size, w - x0), th = std::min(tile_size, h - y0);
+            size_t row_bytes = (size_t)tw * c * sizeof(float);
+
+            std::vector<char> tile(row_bytes * th);
+            for (int j = 0; j < th; ++j) {
+                const float *src = data + ((size_t)(y0 + j) * w + x0) * c;
+                memcpy(tile.data() + j * row_bytes, src, row_bytes);
+            }
+
+            if (comp == tile_compression::none) {
+                payloads[ti].swap(tile);
+                continue;
+            }
+
+#ifdef GRAPHICS_LIB_ZSTD
+            std::vector<char> &compressed = payloads[ti];
+            compressed.resize(ZSTD_compressBound(tile.size()));
+            size_t bytes = ZSTD_compress(compressed.data(), compressed.size(), tile.data(), tile.size(), 1);
+            if (ZSTD_isError(bytes)) {
+                failed = true;
+            } else {
+                compressed.resize(bytes);
+            }
+#endif
+        }
+
+        if (failed) {
+            ERROR("Compressing tiles of {} failed", fname);
+            return false;
+        }
+
+        tile_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, tile_magic, sizeof(tile_magic));
+        header.version     = writer_version;
+        header.w           = w;
+        header.h           = h;
+        header.c           = c;
+        header.tile_size   = tile_size;
+        header.compression = (uint32_t)comp;
+        header.tiles_x     = tiles_x;
+        header.tiles_y     = tiles_y;
+
+        std::vector<tile_entry> index(tile_num);
+        uint64_t offset = sizeof(tile_header) + sizeof(tile_entry) * tile_num;
+        for (int ti = 0; ti < tile_num; ++ti) {
+            index[ti].offset = offset;
+            index[ti].bytes  = payloads[ti].size();
+            offset += payloads[ti].size();
+        }
+
+        std::ofstream output(fname, std::ios::out | std::ios::binary);
+        if (!output.is_open()) {
+            ERROR("Cannot open {}", fname);
+            return false;
+        }
+
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(reinterpret_cast<const char*>(index.data()), sizeof(tile_entry) * index.size());
+        for (auto &p:payloads) {
+            output.write(p.data(), p.size());
+        }
+
+        if (!output.good()) {
+            ERROR("Writing {} failed", fname);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,48 @@
+/* Float image writers for dataset dumps
+ *
+ *  1. NPY (v1.0), loadable by np.load(fname, mmap_mode='r')
+ *  2. Raw float32 with a fixed 64 byte header
+ *  3. Float tiles, each tile optionally compressed (zstd)
+ *
+ *  All writers stream straight from a float buffer, e.g. Image::get_buffer(),
+ *  with one large write for the pixel data.
+ * */
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace purdue {
+    /* Raw layout:
+     *   [0,  8)  magic "GLRAWF32"
+     *   [8, 12)  version
+     *   [12,16)  width
+     *   [16,20)  height
+     *   [20,24)  channels
+     *   [24,64)  zero padding
+     *   [64,..)  float32 data, row-major (h, w, c)
+     *
+     * Python: np.memmap(fname, np.float32, 'r', offset=64, shape=(h, w, c))
+     */
+    constexpr int raw_header_size = 64;
+
+    /* Tile layout:
+     *   header (64 bytes): magic "GLTILE32", version, w, h, c, tile size, compression, tiles_x, tiles_y
+     *   index: tiles_x * tiles_y entries of {uint64 offset, uint64 bytes}
+     *   payloads: each tile stored row-major (tile_h, tile_w, c), border tiles are clipped
+     */
+    enum class tile_compression : uint32_t {
+        none = 0,
+        zstd = 1
+    };
+
+    /* True if the library is built with a compressor */
+    bool tile_compression_available(tile_compression comp);
+
+    bool save_npy(const std::string fname, const float *data, int w, int h, int c);
+    bool save_raw(const std::string fname, const float *data, int w, int h, int c);
+    bool save_float_tiles(const std::string fname,
+                          const float *data,
+                          int w, int h, int c,
+                          int tile_size=64,
+                          tile_compression comp=tile_compression::none);
+}
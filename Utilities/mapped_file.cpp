@@ -0,0 +1,59 @@
+#include "mapped_file.h"
+#include "Utils.h"
+#include "Logger.h"
+
+using namespace boost::interprocess;
+
+mapped_file::mapped_file(const std::string fname) {
+    open(fname);
+}
+
+bool mapped_file::open(const std::string fname) {
+    close();
+
+    if (!purdue::file_exists(fname)) {
+        WARN("Cannot find the file [{}].", fname);
+        return false;
+    }
+
+    try {
+        m_fname = fname;
+        m_size  = (size_t)fs::file_size(fname);
+
+        /* Empty files cannot be mapped */
+        if (m_size == 0) {
+            return true;
+        }
+
+        m_mapping = file_mapping(fname.c_str(), read_only);
+        m_region  = mapped_region(m_mapping, read_only);
+        m_data    = static_cast<const char*>(m_region.get_address());
+    }
+    catch (std::exception &e) {
+        WARN("Cannot map {}: {}", fname, e.what());
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void mapped_file::close() {
+    m_region  = mapped_region();
+    m_mapping = file_mapping();
+    m_data    = nullptr;
+    m_size    = 0;
+    m_fname.clear();
+}
+
+void mapped_file::advise_sequential() {
+    if (m_data) {
+        m_region.advise(mapped_region::advice_sequential);
+    }
+}
+
+void mapped_file::advise_random() {
+    if (m_data) {
+        m_region.advise(mapped_region::advice_random);
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+/* Read-only memory mapped file */
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const std::string fname);
+    ~mapped_file() = default;
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    bool open(const std::string fname);
+    void close();
+
+    bool is_open() const { return !m_fname.empty(); }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    const std::string& file_name() const { return m_fname; }
+
+    /* Hint the kernel about access patterns */
+    void advise_sequential();
+    void advise_random();
+
+private:
+    boost::interprocess::file_mapping m_mapping;
+    boost::interprocess::mapped_region m_region;
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_fname;
+};
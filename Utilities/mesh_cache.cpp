@@ -0,0 +1,317 @@
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#include "mesh_cache.h"
+#include "Utils.h"
+#include "Logger.h"
+#include "Render/mesh.h"
+
+namespace {
+    const char cache_magic[8] = {'G', 'L', 'M', 'E', 'S', 'H', '0', '1'};
+    const uint32_t cache_version = 1;
+    const uint64_t cache_alignment = 64;
+
+    enum cache_flag : uint32_t {
+        has_normal  = 1 << 0,
+        has_color   = 1 << 1,
+        has_uv      = 1 << 2,
+        has_index   = 1 << 3      /* reserved, never written; such entries are rejected */
+    };
+
+    struct cache_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t vert_num;
+        uint64_t index_num;         /* reserved, 0 */
+        int64_t  src_mtime;
+        uint64_t src_size;
+        uint64_t src_hash;
+        float bb_min[3], bb_max[3];
+        uint64_t offsets[5];        /* positions, normals, colors, uvs, reserved */
+        uint64_t padding;
+    };
+    static_assert(sizeof(cache_header) == 128, "mesh cache header should be 128 bytes");
+
+    std::mutex cache_dir_lock;
+    std::string cache_dir;
+
+    uint64_t align(uint64_t v) {
+        return (v + cache_alignment - 1) / cache_alignment * cache_alignment;
+    }
+
+    uint64_t fnv1a(const char *data, size_t size) {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i) {
+            h ^= (unsigned char)data[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    bool source_stamp(const std::string &source, int64_t &mtime, uint64_t &size) {
+        boost::system::error_code ec;
+        mtime = (int64_t)fs::last_write_time(source, ec);
+        if (ec) return false;
+        size = (uint64_t)fs::file_size(source, ec);
+        return !ec;
+    }
+}
+
+
+//------- Cache File --------//
+bool mesh_cache_file::open(const std::string cache_file) {
+    close();
+    if (!purdue::file_exists(cache_file) || !m_file.open(cache_file)) {
+        return false;
+    }
+
+    const char *base = m_file.data();
+    size_t size = m_file.size();
+
+    cache_header header;
+    if (size < sizeof(header)) {
+        close();
+        return false;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 || header.version != cache_version ||
+        (header.flags & has_index)) {
+        close();
+        return false;
+    }
+
+    /* Every array must lie inside the file */
+    uint64_t sizes[4] = {
+        header.vert_num * sizeof(glm::vec3),
+        (header.flags & has_normal) ? header.vert_num * sizeof(glm::vec3) : 0,
+        (header.flags & has_color)  ? header.vert_num * sizeof(glm::vec3) : 0,
+        (header.flags & has_uv)     ? header.vert_num * sizeof(glm::vec2) : 0
+    };
+    for (int i = 0; i < 4; ++i) {
+        if (sizes[i] && header.offsets[i] + sizes[i] > size) {
+            close();
+            return false;
+        }
+    }
+
+    vert_num = header.vert_num;
+    verts   = reinterpret_cast<const glm::vec3*>(base + header.offsets[0]);
+    norms   = sizes[1] ? reinterpret_cast<const glm::vec3*>(base + header.offsets[1]) : nullptr;
+    colors  = sizes[2] ? reinterpret_cast<const glm::vec3*>(base + header.offsets[2]) : nullptr;
+    uvs     = sizes[3] ? reinterpret_cast<const glm::vec2*>(base + header.offsets[3]) : nullptr;
+    bb_min  = glm::vec3(header.bb_min[0], header.bb_min[1], header.bb_min[2]);
+    bb_max  = glm::vec3(header.bb_max[0], header.bb_max[1], header.bb_max[2]);
+
+    m_src_mtime = header.src_mtime;
+    m_src_size  = header.src_size;
+    m_src_hash  = header.src_hash;
+    return true;
+}
+
+void mesh_cache_file::close() {
+    m_file.close();
+    vert_num = 0;
+    verts = norms = colors = nullptr;
+    uvs = nullptr;
+    m_src_mtime = 0;
+    m_src_size = m_src_hash = 0;
+}
+
+
+//------- Cache API --------//
+namespace purdue {
+    void set_mesh_cache_dir(const std::string dir) {
+        std::lock_guard<std::mutex> guard(cache_dir_lock);
+        cache_dir = dir;
+        if (!dir.empty()) {
+            safe_create_folder(dir);
+        }
+    }
+
+    std::string mesh_cache_path(const std::string source) {
+        std::string dir;
+        {
+            std::lock_guard<std::mutex> guard(cache_dir_lock);
+            dir = cache_dir;
+        }
+
+        if (dir.empty()) {
+            return source + ".glmesh";
+        }
+
+        /* Sources with the same name in different folders must not collide */
+        std::string abs_path = file_exists(source) ? get_file_abs_path(source) : source;
+        uint64_t key = fnv1a(abs_path.data(), abs_path.size());
+        return (fs::path(dir) / fmt::format("{}_{:016x}.glmesh", get_file_name(source), key)).string();
+    }
+
+    uint64_t file_hash(const std::string fname) {
+        mapped_file file;
+        if (!file.open(fname)) {
+            return 0;
+        }
+        file.advise_sequential();
+        return fnv1a(file.data(), file.size());
+    }
+
+    bool open_mesh_cache(const std::string source, mesh_cache_file &out) {
+        int64_t mtime;
+        uint64_t size;
+        std::string cache_file = mesh_cache_path(source);
+        if (!source_stamp(source, mtime, size) || !out.open(cache_file)) {
+            return false;
+        }
+
+        /* Size + mtime is the key, like make. The hash is not checked here,
+         * an edit that keeps both is not detected */
+        if (out.source_size() == size && out.source_mtime() == mtime) {
+            return true;
+        }
+
+        /* Touched but maybe not changed, refresh the stamp so the hash is not recomputed next time */
+        if (out.source_size() == size && out.source_hash() == file_hash(source)) {
+            /* The mapping is read-only, unmap before rewriting the header */
+            out.close();
+            {
+                std::fstream stamp(cache_file, std::ios::in | std::ios::out | std::ios::binary);
+                stamp.seekp(offsetof(cache_header, src_mtime));
+                stamp.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+                if (!stamp) {
+                    WARN("Cannot refresh the stamp of {}", cache_file);
+                }
+            }
+            return out.open(cache_file);
+        }
+
+        out.close();
+        return false;
+    }
+
+    bool load_mesh_cache(const std::string source, std::shared_ptr<mesh> &m) {
+        if (!m) {
+            return false;
+        }
+
+        mesh_cache_file cache;
+        if (!open_mesh_cache(source, cache)) {
+            return false;
+        }
+
+        /* One copy out of the mapping, mesh owns std::vector storage */
+        size_t n = cache.vert_num;
+        m->clear_vertices();
+        m->file_path = source;
+        m->m_verts.assign(cache.verts, cache.verts + n);
+        if (cache.norms)  m->m_norms.assign(cache.norms, cache.norms + n);
+        if (cache.colors) m->m_colors.assign(cache.colors, cache.colors + n);
+        if (cache.uvs)    m->m_uvs.assign(cache.uvs, cache.uvs + n);
+
+        m->mark_colors_dirty();
+
+        DBG("{} loaded from cache. {} triangles.", source, m->m_verts.size() / 3);
+        return true;
+    }
+
+    bool save_mesh_cache(const std::string source,
+                         const std::vector<glm::vec3> &verts,
+                         const std::vector<glm::vec3> &norms,
+                         const std::vector<glm::vec3> &colors,
+                         const std::vector<glm::vec2> &uvs) {
+        size_t n = verts.size();
+        cache_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, cache_magic, sizeof(cache_magic));
+        header.version   = cache_version;
+        header.vert_num  = n;
+
+        if (!source_stamp(source, header.src_mtime, header.src_size)) {
+            WARN("Cannot stat {}, mesh cache is not written", source);
+            return false;
+        }
+        header.src_hash = file_hash(source);
+
+        glm::vec3 bb_min(FLT_MAX), bb_max(-FLT_MAX);
+        for (auto &v:verts) {
+            bb_min = glm::min(bb_min, v);
+            bb_max = glm::max(bb_max, v);
+        }
+        for (int i = 0; i < 3; ++i) {
+            header.bb_min[i] = bb_min[i];
+            header.bb_max[i] = bb_max[i];
+        }
+
+        /* Attributes of the wrong size are dropped */
+        const char *arrays[4] = {
+            reinterpret_cast<const char*>(verts.data()),
+            norms.size()  == n ? reinterpret_cast<const char*>(norms.data())  : nullptr,
+            colors.size() == n ? reinterpret_cast<const char*>(colors.data()) : nullptr,
+            uvs.size()    == n ? reinterpret_cast<const char*>(uvs.data())    : nullptr
+        };
+        uint64_t sizes[4] = {
+            n * sizeof(glm::vec3),
+            arrays[1] ? n * sizeof(glm::vec3) : 0,
+            arrays[2] ? n * sizeof(glm::vec3) : 0,
+            arrays[3] ? n * sizeof(glm::vec2) : 0
+        };
+        const uint32_t flags[4] = {0, has_normal, has_color, has_uv};
+
+        uint64_t offset = sizeof(header);
+        for (int i = 0; i < 4; ++i) {
+            if (i > 0 && arrays[i] == nullptr) {
+                continue;
+            }
+            offset = align(offset);
+            header.offsets[i] = offset;
+            header.flags |= flags[i];
+            offset += sizes[i];
+        }
+
+        std::string fname = mesh_cache_path(source);
+        std::string tmp_name = fname + "." + fs::unique_path().string() + ".tmp";
+        {
+            std::ofstream output(tmp_name, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!output.is_open()) {
+                WARN("Cannot write mesh cache {}", fname);
+                return false;
+            }
+
+            static const char zeros[cache_alignment] = {0};
+            uint64_t written = sizeof(header);
+            output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (int i = 0; i < 4; ++i) {
+                if (header.offsets[i] == 0) {
+                    continue;
+                }
+                output.write(zeros, header.offsets[i] - written);
+                output.write(arrays[i], sizes[i]);
+                written = header.offsets[i] + sizes[i];
+            }
+
+            if (!output.good()) {
+                WARN("Writing mesh cache {} failed", fname);
+                output.close();
+                fs::remove(tmp_name);
+                return false;
+            }
+        }
+
+        boost::system::error_code ec;
+        fs::rename(tmp_name, fname, ec);
+        if (ec) {
+            WARN("Cannot move mesh cache to {}: {}", fname, ec.message());
+            fs::remove(tmp_name, ec);
+            return false;
+        }
+        return true;
+    }
+
+    bool save_mesh_cache(const std::string source, const std::shared_ptr<mesh> &m) {
+        if (!m || m->m_verts.empty()) {
+            return false;
+        }
+        return save_mesh_cache(source, m->m_verts, m->m_norms, m->m_colors, m->m_uvs);
+    }
+}
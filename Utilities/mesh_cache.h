@@ -0,0 +1,79 @@
+/* Binary mesh cache
+ *
+ *  Parsed meshes are stored as <source>.glmesh (or in a cache directory) and
+ *  memory mapped on the next load. The key is the source size + mtime: an
+ *  entry is valid if both match, the content hash is only compared when the
+ *  mtime changed (a touched file) and never when the stamp matches.
+ *
+ *  mesh_cache_file is the zero-copy read-only view. load_mesh_cache (the
+ *  warm path of load_model) copies the mapping once, since mesh owns its
+ *  arrays as std::vector.
+ *
+ *  Layout, every array starts 64 byte aligned:
+ *    header (128 bytes)
+ *    positions  vec3 * vert_num
+ *    normals    vec3 * vert_num  (optional)
+ *    colors     vec3 * vert_num  (optional)
+ *    uvs        vec2 * vert_num  (optional)
+ * */
+#pragma once
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <common.h>
+
+#include "mapped_file.h"
+
+class mesh;
+
+/* Read-only view of a cache file, arrays point into the mapping */
+class mesh_cache_file {
+public:
+    mesh_cache_file() = default;
+    ~mesh_cache_file() = default;
+
+    bool open(const std::string cache_file);
+    void close();
+    bool is_open() const { return m_file.is_open(); }
+
+    /* Source stamp the entry was built from */
+    int64_t source_mtime() const { return m_src_mtime; }
+    uint64_t source_size() const { return m_src_size; }
+    uint64_t source_hash() const { return m_src_hash; }
+
+public:
+    size_t vert_num = 0;
+    const glm::vec3 *verts = nullptr;
+    const glm::vec3 *norms = nullptr;   /* nullptr if absent */
+    const glm::vec3 *colors = nullptr;
+    const glm::vec2 *uvs = nullptr;
+    glm::vec3 bb_min, bb_max;
+
+private:
+    mapped_file m_file;
+    int64_t m_src_mtime = 0;
+    uint64_t m_src_size = 0, m_src_hash = 0;
+};
+
+namespace purdue {
+    /* Empty (default): cache files are written next to the source */
+    void set_mesh_cache_dir(const std::string dir);
+    std::string mesh_cache_path(const std::string source);
+
+    /* FNV-1a 64 of the file content */
+    uint64_t file_hash(const std::string fname);
+
+    /* True if a valid entry for source exists, keyed by size + mtime */
+    bool open_mesh_cache(const std::string source, mesh_cache_file &out);
+
+    /* Copy a valid cache entry into m, false if there is none */
+    bool load_mesh_cache(const std::string source, std::shared_ptr<mesh> &m);
+
+    /* Write the entry atomically (temp file + rename) */
+    bool save_mesh_cache(const std::string source,
+                         const std::vector<glm::vec3> &verts,
+                         const std::vector<glm::vec3> &norms,
+                         const std::vector<glm::vec3> &colors,
+                         const std::vector<glm::vec2> &uvs);
+    bool save_mesh_cache(const std::string source, const std::shared_ptr<mesh> &m);
+}
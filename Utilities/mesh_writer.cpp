@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+
+#include "mesh_writer.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        const size_t lines_per_block = 1 << 16;
+
+        /* Append-only text buffer, numbers go through to_chars */
+        struct text_buffer {
+            std::vector<char> data;
+
+            void put(char c) { data.push_back(c); }
+            void put(const char *s) { data.insert(data.end(), s, s + strlen(s)); }
+
+            template<typename T>
+            void put_number(T v) {
+                char tmp[32];
+                auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+                data.insert(data.end(), tmp, res.ptr);
+            }
+
+            void put_vec(const char *prefix, const float *v, int n) {
+                put(prefix);
+                for (int i = 0; i < n; ++i) {
+                    put(' ');
+                    put_number(v[i]);
+                }
+                put('\n');
+            }
+        };
+
+        /* Format lines [0, n) in parallel blocks, f(line, buffer) formats one line */
+        template<typename F>
+        void format_lines(size_t n, std::vector<text_buffer> &blocks, F f) {
+            size_t first = blocks.size();
+            size_t block_num = (n + lines_per_block - 1) / lines_per_block;
+            blocks.resize(first + block_num);
+
+#pragma omp parallel for schedule(dynamic)
+            for (long long bi = 0; bi < (long long)block_num; ++bi) {
+                text_buffer &buf = blocks[first + bi];
+                size_t begin = bi * lines_per_block, end = std::min(n, begin + lines_per_block);
+                buf.data.reserve((end - begin) * 32);
+                for (size_t i = begin; i < end; ++i) {
+                    f(i, buf);
+                }
+            }
+        }
+
+        bool write_blocks(const std::string &fname, const std::vector<text_buffer> &blocks) {
+            std::ofstream output(fname, std::ios::out | std::ios::binary);
+            if (!output.is_open()) {
+                ERROR("Cannot open {}", fname);
+                return false;
+            }
+
+            for (auto &b:blocks) {
+                output.write(b.data.data(), b.data.size());
+            }
+
+            if (!output.good()) {
+                ERROR("Writing {} failed", fname);
+                return false;
+            }
+            return true;
+        }
+
+        /* Unique values by exact bits, index maps every input to its unique value */
+        template<typename T>
+        void weld(const std::vector<T> &in, std::vector<T> &unique, std::vector<uint32_t> &index) {
+            struct bits_hash {
+                size_t operator()(const T &v) const {
+                    size_t h = 0;
+                    for (int i = 0; i < T::length(); ++i) {
+                        uint32_t b;
+                        memcpy(&b, &v[i], sizeof(b));
+                        h = h * 0x9E3779B97F4A7C15ull + b;
+                    }
+                    return h;
+                }
+            };
+            struct bits_equal {
+                bool operator()(const T &a, const T &b) const { return memcmp(&a, &b, sizeof(T)) == 0; }
+            };
+
+            std::unordered_map<T, uint32_t, bits_hash, bits_equal> ids;
+            ids.reserve(in.size() / 2);
+            unique.clear();
+            index.resize(in.size());
+            for (size_t i = 0; i < in.size(); ++i) {
+                auto res = ids.emplace(in[i], (uint32_t)unique.size());
+                if (res.second) {
+                    unique.push_back(in[i]);
+                }
+                index[i] = res.first->second;
+            }
+        }
+    }
+
+    bool save_obj(const std::string fname,
+                  const std::vector<glm::vec3> &verts,
+                  const std::vector<glm::vec3> &norms,
+                  const std::vector<glm::vec2> &uvs,
+                  bool indexed) {
+        size_t n = verts.size();
+        bool has_normal = !norms.empty() && norms.size() == n;
+        bool has_uv = !uvs.empty() && uvs.size() == n;
+
+        std::vector<glm::vec3> v_out, n_out;
+        std::vector<glm::vec2> t_out;
+        std::vector<uint32_t> v_ind, n_ind, t_ind;
+
+        const std::vector<glm::vec3> *pos = &verts, *nor = &norms;
+        const std::vector<glm::vec2> *tex = &uvs;
+        if (indexed) {
+            /* The three channels are independent */
+#pragma omp parallel sections
+            {
+#pragma omp section
+                weld(verts, v_out, v_ind);
+#pragma omp section
+                if (has_normal) weld(norms, n_out, n_ind);
+#pragma omp section
+                if (has_uv) weld(uvs, t_out, t_ind);
+            }
+            pos = &v_out;
+            nor = &n_out;
+            tex = &t_out;
+        }
+
+        auto corner = [&](const std::vector<uint32_t> &ind, size_t i) {
+            return (indexed ? ind[i] : (uint32_t)i) + 1;
+        };
+
+        std::vector<text_buffer> blocks(1);
+        blocks[0].put("# graphics_lib\n");
+
+        format_lines(pos->size(), blocks, [&](size_t i, text_buffer &buf) { buf.put_vec("v", &(*pos)[i].x, 3); });
+        if (has_uv) {
+            format_lines(tex->size(), blocks, [&](size_t i, text_buffer &buf) { buf.put_vec("vt", &(*tex)[i].x, 2); });
+        }
+        if (has_normal) {
+            format_lines(nor->size(), blocks, [&](size_t i, text_buffer &buf) { buf.put_vec("vn", &(*nor)[i].x, 3); });
+        }
+
+        format_lines(n / 3, blocks, [&](size_t ti, text_buffer &buf) {
+            buf.put('f');
+            for (size_t i = ti * 3; i < ti * 3 + 3; ++i) {
+                buf.put(' ');
+                buf.put_number(corner(v_ind, i));
+                if (!has_uv && !has_normal) {
+                    continue;
+                }
+
+                buf.put('/');
+                if (has_uv) buf.put_number(corner(t_ind, i));
+                if (has_normal) {
+                    buf.put('/');
+                    buf.put_number(corner(n_ind, i));
+                }
+            }
+            buf.put('\n');
+        });
+
+        return write_blocks(fname, blocks);
+    }
+
+    bool save_stl(const std::string fname, const std::vector<glm::vec3> &verts, const glm::mat4 &world) {
+        const size_t facet_size = 50;
+        uint32_t tri_num = (uint32_t)(verts.size() / 3);
+        std::vector<char> buffer(84 + (size_t)tri_num * facet_size, 0);
+
+        const char header[] = "binary stl, graphics_lib";
+        memcpy(buffer.data(), header, sizeof(header));
+        memcpy(buffer.data() + 80, &tri_num, sizeof(tri_num));
+
+        bool identity = world == glm::mat4(1.0f);
+#pragma omp parallel for
+        for (long long ti = 0; ti < (long long)tri_num; ++ti) {
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = identity ? verts[ti * 3 + k] : glm::vec3(world * glm::vec4(verts[ti * 3 + k], 1.0f));
+            }
+
+            glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[1]);
+            float len = glm::length(n);
+            n = len > 0.0f ? n / len : glm::vec3(0.0f);
+
+            /* normal, 3 vertices, uint16 attribute (left 0) */
+            char *dst = buffer.data() + 84 + ti * facet_size;
+            memcpy(dst, &n, 12);
+            memcpy(dst + 12, p, 36);
+        }
+
+        std::ofstream output(fname, std::ios::out | std::ios::binary);
+        if (!output.is_open()) {
+            ERROR("Cannot open {}", fname);
+            return false;
+        }
+
+        output.write(buffer.data(), buffer.size());
+        if (!output.good()) {
+            ERROR("Writing {} failed", fname);
+            return false;
+        }
+        return true;
+    }
+
+    bool save_off(const std::string fname, const std::vector<glm::vec3> &verts) {
+        size_t n = verts.size(), tri_num = n / 3;
+
+        std::vector<text_buffer> blocks(1);
+        blocks[0].put("OFF\n");
+        blocks[0].put_number(n);
+        blocks[0].put(' ');
+        blocks[0].put_number(tri_num);
+        blocks[0].put(" 0\n");
+
+        format_lines(n, blocks, [&](size_t i, text_buffer &buf) {
+            const glm::vec3 &v = verts[i];
+            buf.put_number(v.x); buf.put(' ');
+            buf.put_number(v.y); buf.put(' ');
+            buf.put_number(v.z); buf.put('\n');
+        });
+
+        format_lines(tri_num, blocks, [&](size_t ti, text_buffer &buf) {
+            buf.put('3');
+            for (size_t i = ti * 3; i < ti * 3 + 3; ++i) {
+                buf.put(' ');
+                buf.put_number(i);
+            }
+            buf.put('\n');
+        });
+
+        return write_blocks(fname, blocks);
+    }
+}
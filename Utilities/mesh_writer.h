@@ -0,0 +1,30 @@
+/* Mesh writers for triangle soups
+ *
+ *  Text formats are formatted in parallel, every block of lines into its own
+ *  buffer with std::to_chars (shortest round-trip floats), and the blocks are
+ *  written with one large write each. Binary STL is filled in parallel into
+ *  one buffer and written at once.
+ *
+ *  OBJ can be written as a soup (one v/vt/vn per soup vertex) or indexed,
+ *  where positions, uvs and normals are welded separately by exact value.
+ * */
+#pragma once
+#include <string>
+#include <vector>
+#include <common.h>
+
+namespace purdue {
+    /* norms/uvs are written if they match verts in size */
+    bool save_obj(const std::string fname,
+                  const std::vector<glm::vec3> &verts,
+                  const std::vector<glm::vec3> &norms,
+                  const std::vector<glm::vec2> &uvs,
+                  bool indexed=true);
+
+    /* Binary STL, verts are transformed by world on the fly, facet normals are recomputed */
+    bool save_stl(const std::string fname,
+                  const std::vector<glm::vec3> &verts,
+                  const glm::mat4 &world=glm::mat4(1.0f));
+
+    bool save_off(const std::string fname, const std::vector<glm::vec3> &verts);
+}
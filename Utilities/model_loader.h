@@ -1,12 +1,15 @@
 #pragma once
 #include <memory>
-#include "tinyobjloader/tiny_obj_loader.h"
+#include <string>
+#include <vector>
 
 enum model_type {
 	obj,
 	fbx,
 	stl,
 	off,
+	ply,
+	gltf,
 	unknown
 };
 
@@ -29,6 +32,8 @@ public:
 	virtual bool load_model(std::string file_path, std::shared_ptr<mesh>& m) = 0;
 	virtual bool save_model(std::string file_path, std::shared_ptr<mesh>& m) = 0;
 
+	/* Whether loads should go through the binary mesh cache */
+	virtual bool cacheable() { return true; }
 };
 
 class obj_loader : public model_loader {
@@ -41,10 +46,11 @@ public:
 	virtual bool load_model(std::string file_path, std::shared_ptr<mesh>& m) override;
 	virtual bool save_model(std::string file_path, std::shared_ptr<mesh>& m) override;
 
+	/* Indexed output welds positions/uvs/normals, otherwise every soup vertex is written */
+	void set_indexed(bool indexed) { m_indexed = indexed; }
+
 private:
-	void print_info(const tinyobj::attrib_t& attrib,
-					const std::vector<tinyobj::shape_t>& shapes,
-					const std::vector<tinyobj::material_t>& materials);
+	bool m_indexed = true;
 };
 
 class fbx_loader : public model_loader {
@@ -79,3 +85,28 @@ public:
 	virtual bool load_model(std::string file_path, std::shared_ptr<mesh>& m) override;
 	virtual bool save_model(std::string file_path, std::shared_ptr<mesh>& m) override;
 };
+
+class ply_loader :public model_loader {
+public:
+	ply_loader() = default;
+	~ply_loader() {};
+
+	//------- Interface --------//
+public:
+	virtual bool load_model(std::string file_path, std::shared_ptr<mesh>& m) override;
+	virtual bool save_model(std::string file_path, std::shared_ptr<mesh>& m) override;
+};
+
+class gltf_loader :public model_loader {
+public:
+	gltf_loader() = default;
+	~gltf_loader() {};
+
+	//------- Interface --------//
+public:
+	virtual bool load_model(std::string file_path, std::shared_ptr<mesh>& m) override;
+	virtual bool save_model(std::string file_path, std::shared_ptr<mesh>& m) override;
+
+	/* GLB is already binary, and the cache does not keep sub-meshes */
+	virtual bool cacheable() override { return false; }
+};
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <atomic>
+#include <omp.h>
+
+#include "obj_parser.h"
+#include "text_parser.h"
+#include "mapped_file.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        enum class obj_line {
+            v, vn, vt, f, other
+        };
+
+        struct obj_chunk {
+            const char *begin, *end;
+            size_t v = 0, vn = 0, vt = 0, tri = 0;
+        };
+
+        /* Indices of one face corner, -1 if missing */
+        struct obj_corner {
+            int v, vt, vn;
+        };
+
+        obj_line line_type(const char *&p, const char *end) {
+            skip_blank(p, end);
+            if (end - p < 2) {
+                return obj_line::other;
+            }
+
+            if (p[0] == 'v') {
+                if (is_blank(p[1])) { p += 1; return obj_line::v; }
+                if (end - p > 2 && is_blank(p[2])) {
+                    if (p[1] == 'n') { p += 2; return obj_line::vn; }
+                    if (p[1] == 't') { p += 2; return obj_line::vt; }
+                }
+            } else if (p[0] == 'f' && is_blank(p[1])) {
+                p += 1;
+                return obj_line::f;
+            }
+            return obj_line::other;
+        }
+
+        /* Number of corners on a face line */
+        int count_corners(const char *p, const char *end) {
+            int ret = 0;
+            while (true) {
+                skip_blank(p, end);
+                if (p >= end || *p == '\n' || *p == '#') {
+                    return ret;
+                }
+                ++ret;
+                while (p < end && !is_space(*p)) ++p;
+            }
+        }
+
+        /* OBJ index to 0-based, relative to count attributes defined so far */
+        int resolve(int ind, size_t count) {
+            if (ind > 0) return ind - 1;
+            if (ind < 0) return (int)count + ind;
+            return -1;
+        }
+
+        bool parse_corner(const char *&p, const char *end, const obj_chunk &offset, const obj_chunk &local, obj_corner &c) {
+            int v = 0, vt = 0, vn = 0;
+            if (!parse_int(p, end, v)) {
+                return false;
+            }
+
+            if (p < end && *p == '/') {
+                ++p;
+                if (p < end && *p != '/') {
+                    parse_int(p, end, vt);
+                }
+                if (p < end && *p == '/') {
+                    ++p;
+                    parse_int(p, end, vn);
+                }
+            }
+
+            c.v  = resolve(v,  offset.v  + local.v);
+            c.vt = resolve(vt, offset.vt + local.vt);
+            c.vn = resolve(vn, offset.vn + local.vn);
+            return true;
+        }
+
+        void count_chunk(obj_chunk &chunk) {
+            for (const char *line = chunk.begin; line < chunk.end; line = next_line(line, chunk.end)) {
+                const char *p = line;
+                switch (line_type(p, chunk.end)) {
+                case obj_line::v:  ++chunk.v;  break;
+                case obj_line::vn: ++chunk.vn; break;
+                case obj_line::vt: ++chunk.vt; break;
+                case obj_line::f:  chunk.tri += std::max(0, count_corners(p, chunk.end) - 2); break;
+                default: break;
+                }
+            }
+        }
+
+        bool parse_chunk(const obj_chunk &chunk,
+                         const obj_chunk &offset,
+                         std::vector<glm::vec3> &pos,
+                         std::vector<glm::vec3> &nor,
+                         std::vector<glm::vec2> &tex,
+                         std::vector<obj_corner> &corners) {
+            obj_chunk local;
+            std::vector<obj_corner> face;
+
+            for (const char *line = chunk.begin; line < chunk.end; line = next_line(line, chunk.end)) {
+                const char *p = line;
+                bool ok = true;
+                switch (line_type(p, chunk.end)) {
+                case obj_line::v: {
+                    glm::vec3 &v = pos[offset.v + local.v++];
+                    ok = parse_float(p, chunk.end, v.x) && parse_float(p, chunk.end, v.y) && parse_float(p, chunk.end, v.z);
+                    break;
+                }
+                case obj_line::vn: {
+                    glm::vec3 &n = nor[offset.vn + local.vn++];
+                    ok = parse_float(p, chunk.end, n.x) && parse_float(p, chunk.end, n.y) && parse_float(p, chunk.end, n.z);
+                    break;
+                }
+                case obj_line::vt: {
+                    glm::vec2 &t = tex[offset.vt + local.vt++];
+                    ok = parse_float(p, chunk.end, t.x) && parse_float(p, chunk.end, t.y);
+                    break;
+                }
+                case obj_line::f: {
+                    face.clear();
+                    int n = count_corners(p, chunk.end);
+                    for (int ci = 0; ci < n && ok; ++ci) {
+                        obj_corner c;
+                        ok = parse_corner(p, chunk.end, offset, local, c);
+                        face.push_back(c);
+                        while (p < chunk.end && !is_space(*p)) ++p;
+                    }
+
+                    /* Fan triangulation */
+                    for (int ti = 0; ok && ti + 2 < n; ++ti) {
+                        size_t out = (offset.tri + local.tri++) * 3;
+                        corners[out + 0] = face[0];
+                        corners[out + 1] = face[ti + 1];
+                        corners[out + 2] = face[ti + 2];
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+
+                if (!ok) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    bool parse_obj(const std::string fname, std::vector<glm::vec3> &verts, std::vector<glm::vec3> &norms, std::vector<glm::vec2> &uvs) {
+        verts.clear();
+        norms.clear();
+        uvs.clear();
+
+        mapped_file file;
+        if (!file.open(fname)) {
+            return false;
+        }
+        file.advise_sequential();
+
+        const char *begin = file.data(), *end = file.data() + file.size();
+        auto cuts = split_lines(begin, end, omp_get_max_threads() * 4);
+        int chunk_num = (int)cuts.size() - 1;
+
+        std::vector<obj_chunk> chunks(chunk_num);
+        for (int ci = 0; ci < chunk_num; ++ci) {
+            chunks[ci].begin = cuts[ci];
+            chunks[ci].end   = cuts[ci + 1];
+        }
+
+        /* 1. count */
+#pragma omp parallel for schedule(dynamic)
+        for (int ci = 0; ci < chunk_num; ++ci) {
+            count_chunk(chunks[ci]);
+        }
+
+        /* 2. prefix sums */
+        std::vector<obj_chunk> offsets(chunk_num + 1);
+        for (int ci = 0; ci < chunk_num; ++ci) {
+            offsets[ci + 1].v   = offsets[ci].v   + chunks[ci].v;
+            offsets[ci + 1].vn  = offsets[ci].vn  + chunks[ci].vn;
+            offsets[ci + 1].vt  = offsets[ci].vt  + chunks[ci].vt;
+            offsets[ci + 1].tri = offsets[ci].tri + chunks[ci].tri;
+        }
+        const obj_chunk &total = offsets[chunk_num];
+
+        /* 3. parse */
+        std::vector<glm::vec3> pos(total.v), nor(total.vn);
+        std::vector<glm::vec2> tex(total.vt);
+        std::vector<obj_corner> corners(total.tri * 3);
+        std::atomic<bool> ok(true);
+
+#pragma omp parallel for schedule(dynamic)
+        for (int ci = 0; ci < chunk_num; ++ci) {
+            if (!parse_chunk(chunks[ci], offsets[ci], pos, nor, tex, corners)) {
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            ERROR("{} has malformed lines", fname);
+            return false;
+        }
+
+        /* 4. gather triangle soup */
+        long long tri_num = (long long)total.tri;
+        bool has_normal = total.vn > 0, has_uv = total.vt > 0;
+        verts.resize(tri_num * 3);
+        if (has_normal) norms.resize(tri_num * 3);
+        if (has_uv) uvs.resize(tri_num * 3);
+
+#pragma omp parallel for
+        for (long long ti = 0; ti < tri_num; ++ti) {
+            const obj_corner *c = &corners[ti * 3];
+            for (int k = 0; k < 3; ++k) {
+                if (c[k].v < 0 || c[k].v >= (int)total.v) {
+                    ok = false;
+                    verts[ti * 3 + k] = glm::vec3(0.0f);
+                    continue;
+                }
+                verts[ti * 3 + k] = pos[c[k].v];
+            }
+
+            if (has_uv) {
+                for (int k = 0; k < 3; ++k) {
+                    bool valid = c[k].vt >= 0 && c[k].vt < (int)total.vt;
+                    uvs[ti * 3 + k] = valid ? tex[c[k].vt] : glm::vec2(0.0f);
+                }
+            }
+
+            if (has_normal) {
+                for (int k = 0; k < 3; ++k) {
+                    bool valid = c[k].vn >= 0 && c[k].vn < (int)total.vn;
+                    if (valid) {
+                        norms[ti * 3 + k] = nor[c[k].vn];
+                        continue;
+                    }
+
+                    /* Degenerate faces get a zero normal instead of NaN */
+                    glm::vec3 *v = &verts[ti * 3];
+                    glm::vec3 n = glm::cross(v[1] - v[0], v[2] - v[1]);
+                    float len = glm::length(n);
+                    norms[ti * 3 + k] = len > 0.0f ? n / len : glm::vec3(0.0f);
+                }
+            }
+        }
+
+        if (!ok) {
+            ERROR("{} has out of range vertex indices", fname);
+            return false;
+        }
+        return true;
+    }
+}
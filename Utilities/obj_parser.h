@@ -0,0 +1,24 @@
+/* Multithreaded OBJ parser
+ *
+ *  The file is memory mapped and split into chunks at line boundaries.
+ *  1. every chunk counts its v/vn/vt/triangles
+ *  2. prefix sums give each chunk its global offsets, so relative (negative)
+ *     indices resolve without a serial pass
+ *  3. chunks parse into pre-sized attribute pools and face index triples
+ *  4. triangles are gathered into the output triangle soup in parallel
+ *
+ *  Polygons are fan triangulated. Normals are output if the file has any,
+ *  corners without a normal get the face normal. Uvs are output if the file
+ *  has any, corners without a uv get (0,0). Materials/groups are ignored.
+ * */
+#pragma once
+#include <string>
+#include <vector>
+#include <common.h>
+
+namespace purdue {
+    bool parse_obj(const std::string fname,
+                   std::vector<glm::vec3> &verts,
+                   std::vector<glm::vec3> &norms,
+                   std::vector<glm::vec2> &uvs);
+}
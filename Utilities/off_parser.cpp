@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <omp.h>
+
+#include "off_parser.h"
+#include "text_parser.h"
+#include "mapped_file.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        struct off_chunk {
+            const char *begin, *end;
+            size_t count = 0;
+        };
+
+        /* Not blank and not a comment */
+        bool data_line(const char *&p, const char *end) {
+            skip_blank(p, end);
+            return p < end && *p != '\n' && *p != '#';
+        }
+
+        /* Skip comments and blank lines before the next token */
+        void skip_comments(const char *&p, const char *end) {
+            while (true) {
+                skip_space(p, end);
+                if (p >= end || *p != '#') {
+                    return;
+                }
+                p = next_line(p, end);
+            }
+        }
+
+        bool parse_header(const char *&p, const char *end, size_t &vert_num, size_t &face_num) {
+            skip_comments(p, end);
+
+            /* [ST][C][N][4][n]OFF */
+            const char *keyword = p;
+            while (p < end && !is_space(*p) && !(p - keyword >= 3 && memcmp(p - 3, "OFF", 3) == 0)) ++p;
+            if (p - keyword < 3 || memcmp(p - 3, "OFF", 3) != 0) {
+                return false;
+            }
+
+            skip_comments(p, end);
+            if (!parse_int(p, end, vert_num)) return false;
+            skip_comments(p, end);
+            if (!parse_int(p, end, face_num)) return false;
+
+            /* Edge count is optional */
+            p = next_line(p, end);
+            return true;
+        }
+
+        /* End of the n-th data line from p */
+        const char* skip_data_lines(const char *p, const char *end, size_t n) {
+            while (n > 0 && p < end) {
+                const char *q = p;
+                if (data_line(q, end)) --n;
+                p = next_line(p, end);
+            }
+            return p;
+        }
+
+        std::vector<off_chunk> make_chunks(const char *begin, const char *end) {
+            auto cuts = split_lines(begin, end, omp_get_max_threads() * 4);
+            std::vector<off_chunk> ret(cuts.size() - 1);
+            for (size_t ci = 0; ci < ret.size(); ++ci) {
+                ret[ci].begin = cuts[ci];
+                ret[ci].end   = cuts[ci + 1];
+            }
+            return ret;
+        }
+
+        std::vector<size_t> prefix_sum(const std::vector<off_chunk> &chunks) {
+            std::vector<size_t> ret(chunks.size() + 1, 0);
+            for (size_t ci = 0; ci < chunks.size(); ++ci) {
+                ret[ci + 1] = ret[ci] + chunks[ci].count;
+            }
+            return ret;
+        }
+
+        bool parse_vertices(const char *begin, const char *end, size_t vert_num, std::vector<glm::vec3> &positions) {
+            auto chunks = make_chunks(begin, end);
+            int chunk_num = (int)chunks.size();
+
+#pragma omp parallel for schedule(dynamic)
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                for (const char *line = chunks[ci].begin; line < chunks[ci].end; line = next_line(line, chunks[ci].end)) {
+                    const char *p = line;
+                    if (data_line(p, chunks[ci].end)) ++chunks[ci].count;
+                }
+            }
+
+            auto offsets = prefix_sum(chunks);
+            if (offsets.back() != vert_num) {
+                return false;
+            }
+
+            positions.resize(vert_num);
+            std::atomic<bool> ok(true);
+#pragma omp parallel for schedule(dynamic)
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                size_t out = offsets[ci];
+                const char *cend = chunks[ci].end;
+                for (const char *line = chunks[ci].begin; line < cend; line = next_line(line, cend)) {
+                    const char *p = line;
+                    if (!data_line(p, cend)) {
+                        continue;
+                    }
+
+                    glm::vec3 &v = positions[out++];
+                    if (!parse_float(p, cend, v.x) || !parse_float(p, cend, v.y) || !parse_float(p, cend, v.z)) {
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+            return ok;
+        }
+
+        bool parse_faces(const char *begin, const char *end, size_t face_num, size_t vert_num, std::vector<glm::uvec3> &triangles) {
+            auto chunks = make_chunks(begin, end);
+            int chunk_num = (int)chunks.size();
+            std::vector<size_t> faces(chunk_num, 0);
+
+            /* count triangles, faces are counted to stop at face_num */
+#pragma omp parallel for schedule(dynamic)
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                const char *cend = chunks[ci].end;
+                for (const char *line = chunks[ci].begin; line < cend; line = next_line(line, cend)) {
+                    const char *p = line;
+                    int n = 0;
+                    if (!data_line(p, cend) || !parse_int(p, cend, n)) {
+                        continue;
+                    }
+                    chunks[ci].count += std::max(0, n - 2);
+                    ++faces[ci];
+                }
+            }
+
+            size_t total_faces = 0;
+            for (auto f:faces) total_faces += f;
+            if (total_faces != face_num) {
+                return false;
+            }
+
+            auto offsets = prefix_sum(chunks);
+            triangles.resize(offsets.back());
+
+            std::atomic<bool> ok(true);
+#pragma omp parallel for schedule(dynamic)
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                size_t out = offsets[ci];
+                const char *cend = chunks[ci].end;
+                for (const char *line = chunks[ci].begin; line < cend && ok; line = next_line(line, cend)) {
+                    const char *p = line;
+                    int n = 0;
+                    if (!data_line(p, cend) || !parse_int(p, cend, n)) {
+                        continue;
+                    }
+
+                    /* Fan triangulation */
+                    unsigned first = 0, prev = 0;
+                    for (int k = 0; k < n; ++k) {
+                        unsigned ind = 0;
+                        if (!parse_int(p, cend, ind) || ind >= vert_num) {
+                            ok = false;
+                            break;
+                        }
+
+                        if (k == 0) first = ind;
+                        if (k >= 2) triangles[out++] = glm::uvec3(first, prev, ind);
+                        prev = ind;
+                    }
+                }
+            }
+            return ok;
+        }
+    }
+
+    bool parse_off(const std::string fname, std::vector<glm::vec3> &positions, std::vector<glm::uvec3> &triangles) {
+        positions.clear();
+        triangles.clear();
+
+        mapped_file file;
+        if (!file.open(fname)) {
+            return false;
+        }
+        file.advise_sequential();
+
+        const char *p = file.data(), *end = file.data() + file.size();
+        size_t vert_num = 0, face_num = 0;
+        if (!parse_header(p, end, vert_num, face_num)) {
+            ERROR("{} does not have an OFF header", fname);
+            return false;
+        }
+
+        /* The only serial pass: find where the faces start */
+        const char *face_begin = skip_data_lines(p, end, vert_num);
+        const char *face_end   = skip_data_lines(face_begin, end, face_num);
+
+        if (!parse_vertices(p, face_begin, vert_num, positions)) {
+            ERROR("{} has malformed vertices", fname);
+            positions.clear();
+            return false;
+        }
+
+        if (!parse_faces(face_begin, face_end, face_num, vert_num, triangles)) {
+            ERROR("{} has malformed faces", fname);
+            positions.clear();
+            triangles.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool parse_off(const std::string fname, std::vector<glm::vec3> &verts) {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::uvec3> triangles;
+        verts.clear();
+        if (!parse_off(fname, positions, triangles)) {
+            return false;
+        }
+
+        long long tri_num = (long long)triangles.size();
+        verts.resize(tri_num * 3);
+#pragma omp parallel for
+        for (long long ti = 0; ti < tri_num; ++ti) {
+            for (int k = 0; k < 3; ++k) {
+                verts[ti * 3 + k] = positions[triangles[ti][k]];
+            }
+        }
+        return true;
+    }
+}
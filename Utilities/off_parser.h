@@ -0,0 +1,27 @@
+/* OFF parser
+ *
+ *  The file is memory mapped and numbers are parsed with from_chars.
+ *  Every vertex and face is expected on its own line (true for all common
+ *  exporters), which lets both sections be split into chunks at line
+ *  boundaries and parsed in parallel. '#' comments and blank lines are
+ *  skipped. Vertex/face colors after the required fields are ignored.
+ *
+ *  Headers: OFF, COFF, NOFF, ... and the ModelNet variant where the counts
+ *  follow the keyword without a separator ("OFF490 976 0").
+ *
+ *  Polygons are fan triangulated.
+ * */
+#pragma once
+#include <string>
+#include <vector>
+#include <common.h>
+
+namespace purdue {
+    /* Indexed output: vertex positions and triangles into them */
+    bool parse_off(const std::string fname,
+                   std::vector<glm::vec3> &positions,
+                   std::vector<glm::uvec3> &triangles);
+
+    /* Triangle soup output */
+    bool parse_off(const std::string fname, std::vector<glm::vec3> &verts);
+}
@@ -1,5 +1,47 @@
+#include <string>
+
 #include "ogl_helper.h"
 #include "Logger.h"
+#include <GLFW/glfw3.h>
+
+static bool has_ogl_extension(const std::string &name) {
+    GLint num = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num);
+    for (GLint i = 0; i < num; ++i) {
+        const char *ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (ext != nullptr && name == ext) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const ogl_extensions& get_ogl_extensions() {
+    static ogl_extensions ext;
+    static bool loaded = false;
+    if (loaded) {
+        return ext;
+    }
+    loaded = true;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    int version = major * 10 + minor;
+
+    if (version >= 43 || has_ogl_extension("GL_ARB_multi_draw_indirect")) {
+        ext.multi_draw_arrays_indirect = (ogl_multi_draw_arrays_indirect_proc)glfwGetProcAddress("glMultiDrawArraysIndirect");
+    }
+
+    if (version >= 42 || has_ogl_extension("GL_ARB_base_instance")) {
+        ext.draw_arrays_instanced_base_instance = (ogl_draw_arrays_instanced_base_instance_proc)glfwGetProcAddress("glDrawArraysInstancedBaseInstance");
+    }
+
+    INFO("Multi draw indirect: {}, base instance: {}", 
+         ext.multi_draw_arrays_indirect != nullptr, 
+         ext.draw_arrays_instanced_base_instance != nullptr);
+    return ext;
+}
 
 ogl_texture::ogl_texture():m_tex(-1) {
     glGenTextures(1, &m_tex);
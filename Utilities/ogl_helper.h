@@ -4,6 +4,23 @@
 bool init_texutre(GLuint &texid);
 void bind_texture(GLuint texid);
 
+/* Entry points newer than the GL 3.3 glad loader.
+ * Loaded on first call with a current context, null if the driver lacks them.
+ */
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+typedef void (APIENTRYP ogl_multi_draw_arrays_indirect_proc)(GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP ogl_draw_arrays_instanced_base_instance_proc)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount, GLuint baseinstance);
+
+struct ogl_extensions {
+    ogl_multi_draw_arrays_indirect_proc multi_draw_arrays_indirect = nullptr;                   // GL 4.3 or ARB_multi_draw_indirect
+    ogl_draw_arrays_instanced_base_instance_proc draw_arrays_instanced_base_instance = nullptr;  // GL 4.2 or ARB_base_instance
+};
+
+const ogl_extensions& get_ogl_extensions();
+
 /* GPU memory object */
 class ogl_texture {
 public:
@@ -0,0 +1,562 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <omp.h>
+
+#include "ply_parser.h"
+#include "text_parser.h"
+#include "mapped_file.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        enum class ply_format {
+            ascii, binary_le, binary_be
+        };
+
+        enum class ply_type {
+            i8, u8, i16, u16, i32, u32, f32, f64, invalid
+        };
+
+        /* Vertex channels we keep */
+        enum vertex_channel {
+            ch_x, ch_y, ch_z, ch_nx, ch_ny, ch_nz, ch_r, ch_g, ch_b, ch_u, ch_v, ch_num
+        };
+
+        struct ply_property {
+            std::string name;
+            ply_type type = ply_type::invalid;
+            ply_type count_type = ply_type::invalid;   /* lists only */
+            int channel = -1;
+            float scale = 1.0f;
+
+            bool is_list() const { return count_type != ply_type::invalid; }
+        };
+
+        struct ply_element {
+            std::string name;
+            size_t count = 0;
+            std::vector<ply_property> props;
+        };
+
+        /* Rows are decoded in blocks, a block knows where its first row starts */
+        struct ply_block {
+            const char *begin;
+            size_t row0, rows;
+            size_t tri = 0;
+        };
+
+        const size_t rows_per_block = 1 << 14;
+
+        ply_type parse_type(const std::string &s) {
+            if (s == "char"   || s == "int8")    return ply_type::i8;
+            if (s == "uchar"  || s == "uint8")   return ply_type::u8;
+            if (s == "short"  || s == "int16")   return ply_type::i16;
+            if (s == "ushort" || s == "uint16")  return ply_type::u16;
+            if (s == "int"    || s == "int32")   return ply_type::i32;
+            if (s == "uint"   || s == "uint32")  return ply_type::u32;
+            if (s == "float"  || s == "float32") return ply_type::f32;
+            if (s == "double" || s == "float64") return ply_type::f64;
+            return ply_type::invalid;
+        }
+
+        size_t type_size(ply_type t) {
+            switch (t) {
+            case ply_type::i8: case ply_type::u8:   return 1;
+            case ply_type::i16: case ply_type::u16: return 2;
+            case ply_type::i32: case ply_type::u32: case ply_type::f32: return 4;
+            case ply_type::f64: return 8;
+            default: return 0;
+            }
+        }
+
+        int vertex_channel_of(const std::string &name) {
+            static const std::unordered_map<std::string, int> channels = {
+                {"x", ch_x}, {"y", ch_y}, {"z", ch_z},
+                {"nx", ch_nx}, {"ny", ch_ny}, {"nz", ch_nz},
+                {"red", ch_r}, {"green", ch_g}, {"blue", ch_b},
+                {"r", ch_r}, {"g", ch_g}, {"b", ch_b},
+                {"diffuse_red", ch_r}, {"diffuse_green", ch_g}, {"diffuse_blue", ch_b},
+                {"u", ch_u}, {"v", ch_v}, {"s", ch_u}, {"t", ch_v},
+                {"texture_u", ch_u}, {"texture_v", ch_v}, {"texture_s", ch_u}, {"texture_t", ch_v},
+            };
+            auto it = channels.find(name);
+            return it == channels.end() ? -1 : it->second;
+        }
+
+        bool host_little_endian() {
+            uint16_t x = 1;
+            char c;
+            memcpy(&c, &x, 1);
+            return c == 1;
+        }
+
+        template<typename T>
+        double load_as(const char *b) {
+            T v;
+            memcpy(&v, b, sizeof(T));
+            return (double)v;
+        }
+
+        double read_binary(const char *p, ply_type t, bool swap) {
+            char b[8];
+            size_t n = type_size(t);
+            memcpy(b, p, n);
+            if (swap) {
+                std::reverse(b, b + n);
+            }
+
+            switch (t) {
+            case ply_type::i8:  return load_as<int8_t>(b);
+            case ply_type::u8:  return load_as<uint8_t>(b);
+            case ply_type::i16: return load_as<int16_t>(b);
+            case ply_type::u16: return load_as<uint16_t>(b);
+            case ply_type::i32: return load_as<int32_t>(b);
+            case ply_type::u32: return load_as<uint32_t>(b);
+            case ply_type::f32: return load_as<float>(b);
+            case ply_type::f64: return load_as<double>(b);
+            default: return 0.0;
+            }
+        }
+
+        bool parse_number(const char *&p, const char *end, double &out) {
+            skip_blank(p, end);
+            if (p < end && *p == '+') ++p;
+            auto res = std::from_chars(p, end, out);
+            if (res.ec != std::errc()) {
+                return false;
+            }
+            p = res.ptr;
+            return true;
+        }
+
+        std::vector<std::string> split_tokens(const char *p, const char *end) {
+            std::vector<std::string> ret;
+            while (true) {
+                skip_blank(p, end);
+                if (p >= end || *p == '\n') {
+                    return ret;
+                }
+                const char *t = p;
+                while (p < end && !is_space(*p)) ++p;
+                ret.emplace_back(t, p);
+            }
+        }
+
+        bool parse_header(const char *&p, const char *end, ply_format &format, std::vector<ply_element> &elements) {
+            auto tokens = split_tokens(p, end);
+            if (tokens.size() != 1 || tokens[0] != "ply") {
+                return false;
+            }
+
+            bool has_format = false;
+            for (p = next_line(p, end); p < end; p = next_line(p, end)) {
+                tokens = split_tokens(p, end);
+                if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") {
+                    continue;
+                }
+
+                if (tokens[0] == "end_header") {
+                    p = next_line(p, end);
+                    return has_format;
+                }
+
+                if (tokens[0] == "format" && tokens.size() >= 2) {
+                    if (tokens[1] == "ascii") format = ply_format::ascii;
+                    else if (tokens[1] == "binary_little_endian") format = ply_format::binary_le;
+                    else if (tokens[1] == "binary_big_endian") format = ply_format::binary_be;
+                    else return false;
+                    has_format = true;
+                } else if (tokens[0] == "element" && tokens.size() >= 3) {
+                    ply_element e;
+                    e.name  = tokens[1];
+                    e.count = std::stoull(tokens[2]);
+                    elements.push_back(e);
+                } else if (tokens[0] == "property" && !elements.empty()) {
+                    ply_property prop;
+                    if (tokens.size() >= 5 && tokens[1] == "list") {
+                        prop.count_type = parse_type(tokens[2]);
+                        prop.type = parse_type(tokens[3]);
+                        prop.name = tokens[4];
+                        if (prop.count_type == ply_type::invalid) return false;
+                    } else if (tokens.size() >= 3) {
+                        prop.type = parse_type(tokens[1]);
+                        prop.name = tokens[2];
+                    }
+
+                    if (prop.type == ply_type::invalid) {
+                        return false;
+                    }
+                    elements.back().props.push_back(prop);
+                } else {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        /* Decode one row, f(property index, value) is called for every value.
+         * p is moved to the next row. */
+        template<typename F>
+        bool visit_row(const char *&p, const char *end, const ply_element &e, ply_format format, bool swap, F f) {
+            if (format == ply_format::ascii) {
+                const char *line_end = next_line(p, end);
+                for (int pi = 0; pi < (int)e.props.size(); ++pi) {
+                    double value;
+                    int n = 1;
+                    if (e.props[pi].is_list()) {
+                        if (!parse_number(p, line_end, value)) return false;
+                        n = (int)value;
+                    }
+
+                    for (int k = 0; k < n; ++k) {
+                        if (!parse_number(p, line_end, value)) return false;
+                        f(pi, value);
+                    }
+                }
+                p = line_end;
+                return true;
+            }
+
+            for (int pi = 0; pi < (int)e.props.size(); ++pi) {
+                const ply_property &prop = e.props[pi];
+                size_t n = 1, size = type_size(prop.type);
+                if (prop.is_list()) {
+                    size_t count_size = type_size(prop.count_type);
+                    if ((size_t)(end - p) < count_size) return false;
+                    n = (size_t)read_binary(p, prop.count_type, swap);
+                    p += count_size;
+                }
+
+                if ((size_t)(end - p) < n * size) return false;
+                for (size_t k = 0; k < n; ++k, p += size) {
+                    f(pi, read_binary(p, prop.type, swap));
+                }
+            }
+            return true;
+        }
+
+        /* Locate the rows of one element, p is moved past the element */
+        bool make_blocks(const char *&p, const char *end, const ply_element &e, ply_format format, bool swap, std::vector<ply_block> &blocks) {
+            bool fixed = format != ply_format::ascii &&
+                         std::none_of(e.props.begin(), e.props.end(), [](const ply_property &prop) { return prop.is_list(); });
+
+            if (fixed) {
+                size_t stride = 0;
+                for (auto &prop:e.props) stride += type_size(prop.type);
+                if ((size_t)(end - p) < stride * e.count) {
+                    return false;
+                }
+
+                for (size_t r = 0; r < e.count; r += rows_per_block) {
+                    blocks.push_back({p + r * stride, r, std::min(rows_per_block, e.count - r)});
+                }
+                p += stride * e.count;
+                return true;
+            }
+
+            /* Variable rows: one serial scan */
+            for (size_t r = 0; r < e.count; ++r) {
+                if (r % rows_per_block == 0) {
+                    blocks.push_back({p, r, std::min(rows_per_block, e.count - r)});
+                }
+
+                if (format == ply_format::ascii) {
+                    if (p >= end) return false;
+                    p = next_line(p, end);
+                } else if (!visit_row(p, end, e, format, swap, [](int, double) {})) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool parse_vertices(const ply_element &e, const std::vector<ply_block> &blocks, ply_format format, bool swap, const char *end, ply_mesh &out) {
+            bool has[ch_num] = {false};
+            for (auto &prop:e.props) {
+                if (prop.channel >= 0) has[prop.channel] = true;
+            }
+
+            if (!has[ch_x] || !has[ch_y] || !has[ch_z]) {
+                return false;
+            }
+
+            bool has_normal = has[ch_nx] && has[ch_ny] && has[ch_nz];
+            bool has_color  = has[ch_r] && has[ch_g] && has[ch_b];
+            bool has_uv     = has[ch_u] && has[ch_v];
+
+            out.positions.resize(e.count);
+            if (has_normal) out.normals.resize(e.count);
+            if (has_color) out.colors.resize(e.count, glm::vec3(1.0f));
+            if (has_uv) out.uvs.resize(e.count);
+
+            std::atomic<bool> ok(true);
+            int block_num = (int)blocks.size();
+#pragma omp parallel for schedule(dynamic)
+            for (int bi = 0; bi < block_num; ++bi) {
+                const char *p = blocks[bi].begin;
+                for (size_t r = blocks[bi].row0; r < blocks[bi].row0 + blocks[bi].rows; ++r) {
+                    float ch[ch_num] = {0.0f};
+                    bool row_ok = visit_row(p, end, e, format, swap, [&](int pi, double value) {
+                        const ply_property &prop = e.props[pi];
+                        if (prop.channel >= 0 && !prop.is_list()) {
+                            ch[prop.channel] = (float)value * prop.scale;
+                        }
+                    });
+
+                    if (!row_ok) {
+                        ok = false;
+                        break;
+                    }
+
+                    out.positions[r] = glm::vec3(ch[ch_x], ch[ch_y], ch[ch_z]);
+                    if (has_normal) out.normals[r] = glm::vec3(ch[ch_nx], ch[ch_ny], ch[ch_nz]);
+                    if (has_color) out.colors[r] = glm::vec3(ch[ch_r], ch[ch_g], ch[ch_b]);
+                    if (has_uv) out.uvs[r] = glm::vec2(ch[ch_u], ch[ch_v]);
+                }
+            }
+            return ok;
+        }
+
+        bool parse_faces(const ply_element &e, std::vector<ply_block> &blocks, ply_format format, bool swap, const char *end, ply_mesh &out) {
+            int index_prop = -1;
+            for (int pi = 0; pi < (int)e.props.size(); ++pi) {
+                const ply_property &prop = e.props[pi];
+                if (prop.is_list() && (prop.name == "vertex_indices" || prop.name == "vertex_index")) {
+                    index_prop = pi;
+                }
+            }
+
+            if (index_prop < 0) {
+                return false;
+            }
+
+            int block_num = (int)blocks.size();
+            std::atomic<bool> ok(true);
+
+            /* count */
+#pragma omp parallel for schedule(dynamic)
+            for (int bi = 0; bi < block_num; ++bi) {
+                const char *p = blocks[bi].begin;
+                for (size_t r = 0; r < blocks[bi].rows; ++r) {
+                    int n = 0;
+                    if (!visit_row(p, end, e, format, swap, [&](int pi, double) { n += pi == index_prop; })) {
+                        ok = false;
+                        break;
+                    }
+                    blocks[bi].tri += std::max(0, n - 2);
+                }
+            }
+
+            if (!ok) {
+                return false;
+            }
+
+            std::vector<size_t> offsets(block_num + 1, 0);
+            for (int bi = 0; bi < block_num; ++bi) {
+                offsets[bi + 1] = offsets[bi] + blocks[bi].tri;
+            }
+            out.triangles.resize(offsets.back());
+
+            /* decode, fan triangulation */
+            size_t vert_num = out.positions.size();
+#pragma omp parallel for schedule(dynamic)
+            for (int bi = 0; bi < block_num; ++bi) {
+                const char *p = blocks[bi].begin;
+                size_t tri = offsets[bi];
+                std::vector<unsigned> face;
+                for (size_t r = 0; r < blocks[bi].rows; ++r) {
+                    face.clear();
+                    visit_row(p, end, e, format, swap, [&](int pi, double value) {
+                        if (pi == index_prop) face.push_back((unsigned)value);
+                    });
+
+                    for (size_t k = 0; k < face.size(); ++k) {
+                        if (face[k] >= vert_num) ok = false;
+                    }
+
+                    for (size_t k = 2; k < face.size(); ++k) {
+                        out.triangles[tri++] = glm::uvec3(face[0], face[k - 1], face[k]);
+                    }
+                }
+            }
+            return ok;
+        }
+
+        /* Scale integer colors to [0,1] */
+        void set_channels(ply_element &e) {
+            for (auto &prop:e.props) {
+                prop.channel = prop.is_list() ? -1 : vertex_channel_of(prop.name);
+                bool is_color = prop.channel == ch_r || prop.channel == ch_g || prop.channel == ch_b;
+                if (is_color && prop.type == ply_type::u8)  prop.scale = 1.0f / 255.0f;
+                if (is_color && prop.type == ply_type::u16) prop.scale = 1.0f / 65535.0f;
+            }
+        }
+    }
+
+    bool parse_ply(const std::string fname, ply_mesh &out) {
+        out = ply_mesh();
+
+        mapped_file file;
+        if (!file.open(fname)) {
+            return false;
+        }
+        file.advise_sequential();
+
+        const char *p = file.data(), *end = file.data() + file.size();
+        ply_format format = ply_format::ascii;
+        std::vector<ply_element> elements;
+        try {
+            if (!parse_header(p, end, format, elements)) {
+                ERROR("{} does not have a valid PLY header", fname);
+                return false;
+            }
+        }
+        catch (std::exception &e) {
+            ERROR("{} has a malformed PLY header: {}", fname, e.what());
+            return false;
+        }
+
+        bool swap = format != ply_format::ascii && (format == ply_format::binary_le) != host_little_endian();
+        bool has_vertex = false, ok = true;
+        for (auto &e:elements) {
+            std::vector<ply_block> blocks;
+            if (!make_blocks(p, end, e, format, swap, blocks)) {
+                ERROR("{} is truncated in element {}", fname, e.name);
+                return false;
+            }
+
+            if (e.name == "vertex") {
+                set_channels(e);
+                ok = parse_vertices(e, blocks, format, swap, end, out);
+                has_vertex = true;
+            } else if (e.name == "face") {
+                ok = has_vertex && parse_faces(e, blocks, format, swap, end, out);
+            }
+
+            if (!ok) {
+                ERROR("{} has malformed element {}", fname, e.name);
+                out = ply_mesh();
+                return false;
+            }
+        }
+
+        if (!has_vertex) {
+            ERROR("{} does not have vertices", fname);
+            return false;
+        }
+        return true;
+    }
+
+    bool parse_ply(const std::string fname, std::vector<glm::vec3> &verts, std::vector<glm::vec3> &norms, std::vector<glm::vec3> &colors, std::vector<glm::vec2> &uvs) {
+        verts.clear();
+        norms.clear();
+        colors.clear();
+        uvs.clear();
+
+        ply_mesh m;
+        if (!parse_ply(fname, m)) {
+            return false;
+        }
+
+        long long tri_num = (long long)m.triangles.size();
+        verts.resize(tri_num * 3);
+        if (!m.normals.empty()) norms.resize(tri_num * 3);
+        if (!m.colors.empty()) colors.resize(tri_num * 3);
+        if (!m.uvs.empty()) uvs.resize(tri_num * 3);
+
+#pragma omp parallel for
+        for (long long ti = 0; ti < tri_num; ++ti) {
+            for (int k = 0; k < 3; ++k) {
+                size_t i = ti * 3 + k, src = m.triangles[ti][k];
+                verts[i] = m.positions[src];
+                if (!m.normals.empty()) norms[i] = m.normals[src];
+                if (!m.colors.empty()) colors[i] = m.colors[src];
+                if (!m.uvs.empty()) uvs[i] = m.uvs[src];
+            }
+        }
+        return true;
+    }
+
+    bool save_ply(const std::string fname, const std::vector<glm::vec3> &verts, const std::vector<glm::vec3> &norms, const std::vector<glm::vec3> &colors, bool binary) {
+        size_t n = verts.size(), tri_num = n / 3;
+        bool has_normal = norms.size() == n, has_color = colors.size() == n;
+
+        std::string header = "ply\n";
+        if (!binary) {
+            header += "format ascii 1.0\n";
+        } else {
+            /* Written in host order, nothing to swap */
+            header += host_little_endian() ? "format binary_little_endian 1.0\n" : "format binary_big_endian 1.0\n";
+        }
+        header += fmt::format("element vertex {}\nproperty float x\nproperty float y\nproperty float z\n", n);
+        if (has_normal) header += "property float nx\nproperty float ny\nproperty float nz\n";
+        if (has_color) header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        header += fmt::format("element face {}\nproperty list uchar int vertex_indices\nend_header\n", tri_num);
+
+        auto to_u8 = [](float c) { return (unsigned char)(glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f); };
+
+        std::vector<char> vert_block, face_block;
+        if (binary) {
+            size_t stride = 12 + (has_normal ? 12 : 0) + (has_color ? 3 : 0);
+            size_t face_stride = 1 + 3 * sizeof(int32_t);
+            vert_block.resize(stride * n);
+            face_block.resize(face_stride * tri_num);
+
+            long long vn = (long long)n;
+#pragma omp parallel for
+            for (long long vi = 0; vi < vn; ++vi) {
+                char *dst = vert_block.data() + vi * stride;
+                memcpy(dst, &verts[vi], 12);
+                dst += 12;
+                if (has_normal) {
+                    memcpy(dst, &norms[vi], 12);
+                    dst += 12;
+                }
+                if (has_color) {
+                    for (int c = 0; c < 3; ++c) dst[c] = (char)to_u8(colors[vi][c]);
+                }
+            }
+
+            long long tn = (long long)tri_num;
+#pragma omp parallel for
+            for (long long ti = 0; ti < tn; ++ti) {
+                char *dst = face_block.data() + ti * face_stride;
+                int32_t ind[3] = {(int32_t)(ti * 3), (int32_t)(ti * 3 + 1), (int32_t)(ti * 3 + 2)};
+                dst[0] = 3;
+                memcpy(dst + 1, ind, sizeof(ind));
+            }
+        } else {
+            fmt::memory_buffer buf;
+            for (size_t vi = 0; vi < n; ++vi) {
+                const glm::vec3 &v = verts[vi];
+                fmt::format_to(std::back_inserter(buf), "{} {} {}", v.x, v.y, v.z);
+                if (has_normal) fmt::format_to(std::back_inserter(buf), " {} {} {}", norms[vi].x, norms[vi].y, norms[vi].z);
+                if (has_color) fmt::format_to(std::back_inserter(buf), " {} {} {}", to_u8(colors[vi].x), to_u8(colors[vi].y), to_u8(colors[vi].z));
+                buf.push_back('\n');
+            }
+            vert_block.assign(buf.data(), buf.data() + buf.size());
+
+            buf.clear();
+            for (size_t ti = 0; ti < tri_num; ++ti) {
+                fmt::format_to(std::back_inserter(buf), "3 {} {} {}\n", ti * 3, ti * 3 + 1, ti * 3 + 2);
+            }
+            face_block.assign(buf.data(), buf.data() + buf.size());
+        }
+
+        std::ofstream output(fname, std::ios::out | std::ios::binary);
+        if (!output.is_open()) {
+            ERROR("Cannot open {}", fname);
+            return false;
+        }
+
+        output.write(header.data(), header.size());
+        output.write(vert_block.data(), vert_block.size());
+        output.write(face_block.data(), face_block.size());
+        if (!output.good()) {
+            ERROR("Writing {} failed", fname);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,49 @@
+/* PLY reader and writer
+ *
+ *  Reading: the file is memory mapped and the header describes the layout,
+ *  any property order/type is accepted. Binary (both endians) and ASCII
+ *  bodies are supported.
+ *   - binary: rows with list properties are located by one serial scan,
+ *     fixed size rows are addressed directly, rows are decoded in parallel
+ *   - ascii:  one row per line, sections are split into chunks at line
+ *     boundaries and decoded in parallel
+ *
+ *  Vertex properties used: x y z, nx ny nz, red green blue (r g b,
+ *  diffuse_*), u v (s t, texture_*). Integer colors are normalized to [0,1].
+ *  Faces use the vertex_indices (or vertex_index) list, polygons are fan
+ *  triangulated. Other elements and properties are skipped.
+ *
+ *  Writing: binary in host byte order or ASCII, the triangle soup is welded
+ *  into one vertex per soup vertex (no deduplication).
+ * */
+#pragma once
+#include <string>
+#include <vector>
+#include <common.h>
+
+namespace purdue {
+    /* Indexed data of a PLY file, optional channels are empty if missing */
+    struct ply_mesh {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec3> colors;
+        std::vector<glm::vec2> uvs;
+        std::vector<glm::uvec3> triangles;
+    };
+
+    bool parse_ply(const std::string fname, ply_mesh &out);
+
+    /* Triangle soup output */
+    bool parse_ply(const std::string fname,
+                   std::vector<glm::vec3> &verts,
+                   std::vector<glm::vec3> &norms,
+                   std::vector<glm::vec3> &colors,
+                   std::vector<glm::vec2> &uvs);
+
+    /* norms/colors are written if they match verts in size */
+    bool save_ply(const std::string fname,
+                  const std::vector<glm::vec3> &verts,
+                  const std::vector<glm::vec3> &norms,
+                  const std::vector<glm::vec3> &colors,
+                  bool binary=true);
+}
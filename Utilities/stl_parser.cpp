@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <omp.h>
+
+#include "stl_parser.h"
+#include "text_parser.h"
+#include "mapped_file.h"
+#include "Logger.h"
+
+namespace purdue {
+    namespace {
+        const size_t stl_header_size = 84;
+        const size_t stl_facet_size  = 50;
+
+        struct stl_chunk {
+            const char *begin, *end;
+            size_t v = 0;
+        };
+
+        glm::vec3 face_normal(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &fallback) {
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p1);
+            float len = glm::length(n);
+            return len > 0.0f ? n / len : fallback;
+        }
+
+        /* Skip blanks, true if the line continues with keyword */
+        bool match_keyword(const char *&p, const char *end, const char *keyword) {
+            skip_blank(p, end);
+            size_t n = strlen(keyword);
+            if ((size_t)(end - p) < n + 1 || memcmp(p, keyword, n) != 0 || !is_blank(p[n])) {
+                return false;
+            }
+            p += n;
+            return true;
+        }
+
+        bool is_ascii(const char *begin, const char *end) {
+            const char *p = begin;
+            skip_space(p, end);
+            return end - p >= 5 && memcmp(p, "solid", 5) == 0;
+        }
+
+        bool parse_binary(const char *data, size_t tri_num, std::vector<glm::vec3> &verts, std::vector<glm::vec3> &norms) {
+            verts.resize(tri_num * 3);
+            norms.resize(tri_num * 3);
+
+            const char *facets = data + stl_header_size;
+            long long n = (long long)tri_num;
+#pragma omp parallel for
+            for (long long ti = 0; ti < n; ++ti) {
+                /* facet: normal, 3 vertices, uint16 attribute. Not 4 byte aligned */
+                float f[12];
+                memcpy(f, facets + ti * stl_facet_size, sizeof(f));
+
+                glm::vec3 *v = &verts[ti * 3];
+                v[0] = glm::vec3(f[3], f[4],  f[5]);
+                v[1] = glm::vec3(f[6], f[7],  f[8]);
+                v[2] = glm::vec3(f[9], f[10], f[11]);
+
+                glm::vec3 normal = face_normal(v[0], v[1], v[2], glm::vec3(f[0], f[1], f[2]));
+                norms[ti * 3 + 0] = norms[ti * 3 + 1] = norms[ti * 3 + 2] = normal;
+            }
+            return true;
+        }
+
+        bool parse_ascii(const char *begin, const char *end, std::vector<glm::vec3> &verts, std::vector<glm::vec3> &norms) {
+            auto cuts = split_lines(begin, end, omp_get_max_threads() * 4);
+            int chunk_num = (int)cuts.size() - 1;
+
+            std::vector<stl_chunk> chunks(chunk_num);
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                chunks[ci].begin = cuts[ci];
+                chunks[ci].end   = cuts[ci + 1];
+            }
+
+            /* count */
+#pragma omp parallel for schedule(dynamic)
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                stl_chunk &chunk = chunks[ci];
+                for (const char *line = chunk.begin; line < chunk.end; line = next_line(line, chunk.end)) {
+                    const char *p = line;
+                    if (match_keyword(p, chunk.end, "vertex")) {
+                        ++chunk.v;
+                    }
+                }
+            }
+
+            std::vector<size_t> offsets(chunk_num + 1, 0);
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                offsets[ci + 1] = offsets[ci] + chunks[ci].v;
+            }
+
+            size_t vert_num = offsets[chunk_num];
+            if (vert_num % 3 != 0) {
+                return false;
+            }
+            verts.resize(vert_num);
+            norms.resize(vert_num);
+
+            /* parse */
+            std::atomic<bool> ok(true);
+#pragma omp parallel for schedule(dynamic)
+            for (int ci = 0; ci < chunk_num; ++ci) {
+                const stl_chunk &chunk = chunks[ci];
+                size_t out = offsets[ci];
+                for (const char *line = chunk.begin; line < chunk.end; line = next_line(line, chunk.end)) {
+                    const char *p = line;
+                    if (!match_keyword(p, chunk.end, "vertex")) {
+                        continue;
+                    }
+
+                    glm::vec3 &v = verts[out++];
+                    if (!parse_float(p, chunk.end, v.x) || !parse_float(p, chunk.end, v.y) || !parse_float(p, chunk.end, v.z)) {
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+
+            if (!ok) {
+                return false;
+            }
+
+            long long tri_num = (long long)(vert_num / 3);
+#pragma omp parallel for
+            for (long long ti = 0; ti < tri_num; ++ti) {
+                glm::vec3 *v = &verts[ti * 3];
+                glm::vec3 normal = face_normal(v[0], v[1], v[2], glm::vec3(0.0f));
+                norms[ti * 3 + 0] = norms[ti * 3 + 1] = norms[ti * 3 + 2] = normal;
+            }
+            return true;
+        }
+    }
+
+    bool parse_stl(const std::string fname, std::vector<glm::vec3> &verts, std::vector<glm::vec3> &norms) {
+        verts.clear();
+        norms.clear();
+
+        mapped_file file;
+        if (!file.open(fname)) {
+            return false;
+        }
+        file.advise_sequential();
+
+        const char *begin = file.data(), *end = file.data() + file.size();
+        size_t size = file.size();
+
+        uint32_t tri_num = 0;
+        if (size >= stl_header_size) {
+            memcpy(&tri_num, begin + 80, sizeof(tri_num));
+        }
+
+        bool binary_size = size >= stl_header_size && size == stl_header_size + (size_t)tri_num * stl_facet_size;
+        if (binary_size || (size >= stl_header_size && !is_ascii(begin, end))) {
+            if (!binary_size) {
+                /* Some exporters pad the file, still readable if all facets are there */
+                if (size < stl_header_size + (size_t)tri_num * stl_facet_size) {
+                    ERROR("{} is truncated: {} triangles need {} bytes, file has {}", fname, tri_num, stl_header_size + (size_t)tri_num * stl_facet_size, size);
+                    return false;
+                }
+                WARN("{} has {} trailing bytes", fname, size - stl_header_size - (size_t)tri_num * stl_facet_size);
+            }
+            return parse_binary(begin, tri_num, verts, norms);
+        }
+
+        if (!is_ascii(begin, end)) {
+            ERROR("{} is not a STL file", fname);
+            return false;
+        }
+
+        if (!parse_ascii(begin, end, verts, norms)) {
+            ERROR("{} has malformed facets", fname);
+            verts.clear();
+            norms.clear();
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,23 @@
+/* STL parser
+ *
+ *  The file is memory mapped. Binary files are detected from the triangle
+ *  count in the header (size == 84 + 50 * n), so binary files whose header
+ *  starts with "solid" still take the binary path.
+ *
+ *  Binary: facets are decoded in parallel straight into the output arrays.
+ *  ASCII:  the text is split into chunks at line boundaries, chunks count
+ *          their "vertex" lines, then parse into their prefix offsets.
+ *
+ *  Normals are recomputed from the triangle winding, degenerate triangles
+ *  keep the facet normal stored in the file (binary) or get zero (ASCII).
+ * */
+#pragma once
+#include <string>
+#include <vector>
+#include <common.h>
+
+namespace purdue {
+    bool parse_stl(const std::string fname,
+                   std::vector<glm::vec3> &verts,
+                   std::vector<glm::vec3> &norms);
+}
@@ -0,0 +1,85 @@
+/* Small helpers for parsing memory mapped text files
+ *
+ *  Nothing here allocates or uses locales, numbers are parsed with
+ *  std::from_chars. All functions take a cursor and an end pointer and
+ *  advance the cursor past what they consumed.
+ * */
+#pragma once
+#include <charconv>
+#include <vector>
+#include <cstddef>
+
+namespace purdue {
+    inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+    inline bool is_space(char c) { return is_blank(c) || c == '\n'; }
+
+    /* Skip blanks on the current line */
+    inline void skip_blank(const char *&p, const char *end) {
+        while (p < end && is_blank(*p)) ++p;
+    }
+
+    /* Skip blanks and new lines */
+    inline void skip_space(const char *&p, const char *end) {
+        while (p < end && is_space(*p)) ++p;
+    }
+
+    /* Pointer past the next '\n' (or end) */
+    inline const char* next_line(const char *p, const char *end) {
+        while (p < end && *p != '\n') ++p;
+        return p < end ? p + 1 : end;
+    }
+
+    inline bool parse_float(const char *&p, const char *end, float &out) {
+        skip_blank(p, end);
+        if (p < end && *p == '+') ++p;
+        auto res = std::from_chars(p, end, out);
+        if (res.ec != std::errc()) {
+            return false;
+        }
+        p = res.ptr;
+        return true;
+    }
+
+    template<typename T>
+    inline bool parse_int(const char *&p, const char *end, T &out) {
+        skip_blank(p, end);
+        if (p < end && *p == '+') ++p;
+        auto res = std::from_chars(p, end, out);
+        if (res.ec != std::errc()) {
+            return false;
+        }
+        p = res.ptr;
+        return true;
+    }
+
+    /* Same as above but whitespace includes new lines, for token streams like OFF */
+    inline bool next_float(const char *&p, const char *end, float &out) {
+        skip_space(p, end);
+        return parse_float(p, end, out);
+    }
+
+    template<typename T>
+    inline bool next_int(const char *&p, const char *end, T &out) {
+        skip_space(p, end);
+        return parse_int(p, end, out);
+    }
+
+    /* Split [begin, end) into about n pieces, every piece starts at a line start */
+    inline std::vector<const char*> split_lines(const char *begin, const char *end, int n) {
+        std::vector<const char*> ret;
+        ret.push_back(begin);
+        size_t size = end - begin;
+        for (int i = 1; i < n; ++i) {
+            const char *p = begin + size * i / n;
+            if (p <= ret.back()) {
+                continue;
+            }
+            p = next_line(p - 1, end);
+            if (p > ret.back() && p < end) {
+                ret.push_back(p);
+            }
+        }
+        ret.push_back(end);
+        return ret;
+    }
+}
@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <omp.h>
+#include "thread_pool.h"
+
+thread_pool::thread_pool(size_t n) {
+    n = std::max<size_t>(n, 1);
+
+    /* Tasks (the mesh parsers) open their own OpenMP teams, split the cores
+     * between workers so P workers do not run P x P threads */
+    int omp_threads = std::max(1, (int)(std::thread::hardware_concurrency() / n));
+    for (size_t i = 0; i < n; ++i) {
+        m_workers.emplace_back([this, omp_threads]() {
+            omp_set_num_threads(omp_threads);
+            worker();
+        });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (auto &t:m_workers) {
+        t.join();
+    }
+}
+
+thread_pool* thread_pool::instance() {
+    static thread_pool pool;
+    return &pool;
+}
+
+void thread_pool::worker() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(m_lock);
+            m_cv.wait(guard, [this]() { return m_stop || !m_tasks.empty(); });
+
+            /* Drain the queue before stopping */
+            if (m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
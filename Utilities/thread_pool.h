@@ -0,0 +1,52 @@
+/* Fixed size worker pool
+ *
+ *  submit() queues a callable and returns a future of its result.
+ *  thread_pool::instance() is the shared pool used for background IO
+ *  (mesh loading); create a separate pool for anything long running.
+ *  OpenMP regions inside a task get hardware_concurrency() / size() threads,
+ *  one with the default size.
+ * */
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class thread_pool {
+public:
+    thread_pool(size_t n=std::thread::hardware_concurrency());
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    static thread_pool* instance();
+
+    template<typename F>
+    auto submit(F f) -> std::future<decltype(f())> {
+        using R = decltype(f());
+        auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+        std::future<R> ret = task->get_future();
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_tasks.push([task]() { (*task)(); });
+        }
+        m_cv.notify_one();
+        return ret;
+    }
+
+    size_t size() const { return m_workers.size(); }
+
+private:
+    void worker();
+
+private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+};
@@ -0,0 +1,109 @@
+#include <cstring>
+#include "tiled_image.h"
+
+/* Spread the lower 16 bits of v to the even bits */
+static uint32_t part1by1(uint32_t v) {
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+tiled_image::tiled_image() {
+    init(0, 0, 3, tile_order::row_major);
+}
+
+tiled_image::tiled_image(int w, int h, int tile_log2, tile_order order) {
+    init(w, h, tile_log2, order);
+}
+
+tiled_image::tiled_image(const Image &img, int tile_log2, tile_order order) {
+    init(img.width(), img.height(), tile_log2, order);
+    from_image(img);
+}
+
+void tiled_image::init(int w, int h, int tile_log2, tile_order order) {
+    FAIL(tile_log2 < 0 || tile_log2 > 8, "Tile size 2^{} is not supported", tile_log2);
+
+    m_w       = w;
+    m_h       = h;
+    m_log2    = tile_log2;
+    m_mask    = (1 << tile_log2) - 1;
+    m_order   = order;
+    m_tiles_x = (w + m_mask) >> tile_log2;
+    m_tiles_y = (h + m_mask) >> tile_log2;
+
+    int ts = tile_size();
+    m_x_offset.resize(ts);
+    m_y_offset.resize(ts);
+    for (int k = 0; k < ts; ++k) {
+        if (order == tile_order::morton) {
+            m_x_offset[k] = part1by1(k);
+            m_y_offset[k] = part1by1(k) << 1;
+        } else {
+            m_x_offset[k] = k;
+            m_y_offset[k] = k << tile_log2;
+        }
+    }
+
+    m_buffer.clear();
+    m_buffer.resize(((size_t)m_tiles_x * m_tiles_y) << (2 * tile_log2), glm::vec4(0.0f));
+}
+
+void tiled_image::from_image(const Image &img) {
+    if (img.width() != m_w || img.height() != m_h) {
+        init(img.width(), img.height(), m_log2, m_order);
+    }
+
+    const glm::vec4 *src = img.data();
+    for_each_tile([&](int tx, int ty) {
+        int x0 = tx << m_log2, y0 = ty << m_log2;
+        int tw = std::min(tile_size(), m_w - x0), th = std::min(tile_size(), m_h - y0);
+        glm::vec4 *dst = tile_data(tx, ty);
+
+        for (int j = 0; j < th; ++j) {
+            const glm::vec4 *src_row = src + (size_t)(y0 + j) * m_w + x0;
+            if (m_order == tile_order::row_major) {
+                memcpy(dst + ((size_t)j << m_log2), src_row, sizeof(glm::vec4) * tw);
+                continue;
+            }
+
+            uint32_t y_off = m_y_offset[j];
+            for (int i = 0; i < tw; ++i) {
+                dst[m_x_offset[i] + y_off] = src_row[i];
+            }
+        }
+    });
+}
+
+Image tiled_image::to_image() const {
+    Image ret(m_w, m_h);
+    glm::vec4 *dst = ret.data();
+
+    for_each_tile([&](int tx, int ty) {
+        int x0 = tx << m_log2, y0 = ty << m_log2;
+        int tw = std::min(tile_size(), m_w - x0), th = std::min(tile_size(), m_h - y0);
+        const glm::vec4 *src = tile_data(tx, ty);
+
+        for (int j = 0; j < th; ++j) {
+            glm::vec4 *dst_row = dst + (size_t)(y0 + j) * m_w + x0;
+            if (m_order == tile_order::row_major) {
+                memcpy(dst_row, src + ((size_t)j << m_log2), sizeof(glm::vec4) * tw);
+                continue;
+            }
+
+            uint32_t y_off = m_y_offset[j];
+            for (int i = 0; i < tw; ++i) {
+                dst_row[i] = src[m_x_offset[i] + y_off];
+            }
+        }
+    });
+
+    return ret;
+}
+
+void tiled_image::clear(glm::vec4 c) {
+    std::fill(m_buffer.begin(), m_buffer.end(), c);
+}
@@ -0,0 +1,95 @@
+/* Tiled image layout for neighbourhood kernels
+ *
+ *  Pixels are stored tile by tile, tile size is a power of two. Inside a
+ *  tile pixels are row-major or Z-order (Morton). Vertical neighbours are
+ *  at most one tile row apart instead of one image row, which keeps filters
+ *  and rasterization on large images inside cache/TLB.
+ *
+ *  Border tiles are padded, padding pixels are never visited by for_each_pixel.
+ * */
+#pragma once
+#include <common.h>
+#include <cstdint>
+
+enum class tile_order {
+    row_major,
+    morton
+};
+
+class tiled_image {
+public:
+    tiled_image();
+    tiled_image(int w, int h, int tile_log2=3, tile_order order=tile_order::row_major);
+    tiled_image(const Image &img, int tile_log2=3, tile_order order=tile_order::row_major);
+    ~tiled_image()=default;
+
+    /* Properties */
+    int width() const { return m_w; }
+    int height() const { return m_h; }
+    int tile_size() const { return 1 << m_log2; }
+    int tiles_x() const { return m_tiles_x; }
+    int tiles_y() const { return m_tiles_y; }
+    tile_order order() const { return m_order; }
+
+    /* Accessors, the swizzle is hidden here. No bounds check */
+    size_t index(int i, int j) const {
+        size_t tile = (size_t)(j >> m_log2) * m_tiles_x + (i >> m_log2);
+        return (tile << (2 * m_log2)) + m_x_offset[i & m_mask] + m_y_offset[j & m_mask];
+    }
+    glm::vec4& at(int i, int j) { return m_buffer[index(i, j)]; }
+    glm::vec4 get(int i, int j) const { return m_buffer[index(i, j)]; }
+
+    /* Out of range coordinates are clamped to the border, same as Image::padding */
+    glm::vec4 get_clamped(int i, int j) const {
+        i = std::min(std::max(i, 0), m_w - 1);
+        j = std::min(std::max(j, 0), m_h - 1);
+        return get(i, j);
+    }
+
+    /* Pixels of one tile are contiguous */
+    glm::vec4* tile_data(int tx, int ty) { return m_buffer.data() + (((size_t)ty * m_tiles_x + tx) << (2 * m_log2)); }
+    const glm::vec4* tile_data(int tx, int ty) const { return m_buffer.data() + (((size_t)ty * m_tiles_x + tx) << (2 * m_log2)); }
+
+    /* f(tx, ty), tiles are processed in parallel */
+    template<typename F>
+    void for_each_tile(F f) const {
+        int tile_num = m_tiles_x * m_tiles_y;
+#pragma omp parallel for schedule(dynamic)
+        for (int t = 0; t < tile_num; ++t) {
+            f(t % m_tiles_x, t / m_tiles_x);
+        }
+    }
+
+    /* f(i, j, pixel) tile by tile and row major inside a tile, which is memory
+     * order only for the row-major layout. Tiles are processed in parallel */
+    template<typename F>
+    void for_each_pixel(F f) {
+        for_each_tile([&](int tx, int ty) {
+            int x0 = tx << m_log2, y0 = ty << m_log2;
+            int tw = std::min(tile_size(), m_w - x0), th = std::min(tile_size(), m_h - y0);
+            for (int j = y0; j < y0 + th; ++j) for (int i = x0; i < x0 + tw; ++i) {
+                f(i, j, at(i, j));
+            }
+        });
+    }
+
+    /* Layout conversion */
+    void from_image(const Image &img);
+    Image to_image() const;
+    void clear(glm::vec4 c=glm::vec4(0.0f));
+
+    std::vector<glm::vec4>& get_buffer() { return m_buffer; }
+
+private:
+    void init(int w, int h, int tile_log2, tile_order order);
+
+private:
+    int m_w, m_h;
+    int m_log2, m_mask;
+    int m_tiles_x, m_tiles_y;
+    tile_order m_order;
+
+    /* In-tile offset of a pixel is m_x_offset[i & mask] + m_y_offset[j & mask] */
+    std::vector<uint32_t> m_x_offset, m_y_offset;
+    std::vector<glm::vec4> m_buffer;
+};
@@ -0,0 +1,140 @@
+#include "asset_manager.h"
+#include "Utilities/Utils.h"
+#include "Utilities/Logger.h"
+
+std::string asset_manager::canonical_path(const std::string mesh_file) {
+    try {
+        return purdue::get_file_abs_path(mesh_file);
+    }
+    catch (std::exception &e) {
+        return mesh_file;
+    }
+}
+
+std::shared_ptr<mesh_geometry> asset_manager::load_geometry(const std::string mesh_file) {
+    return load(mesh_file, nullptr);
+}
+
+std::shared_ptr<mesh_geometry> asset_manager::load(const std::string mesh_file, std::shared_ptr<mesh> *loaded) {
+    std::string key = canonical_path(mesh_file);
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            ++m_hits;
+            return it->second.geometry;
+        }
+    }
+
+    /* Load without holding the lock, other files can be served meanwhile */
+    ++m_misses;
+    auto tmp = std::make_shared<mesh>();
+    if (!load_model(mesh_file, tmp)) {
+        return nullptr;
+    }
+
+    if (tmp->m_verts.size() != tmp->m_norms.size()) {
+        tmp->recompute_normal();
+    }
+
+    auto geometry = tmp->get_geometry();
+    if (!tmp->m_colors.empty() && tmp->m_colors.size() == tmp->m_verts.size()) {
+        geometry->colors = tmp->m_colors;
+    }
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    /* Someone else loaded it first, keep theirs so instances share one copy */
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        return it->second.geometry;
+    }
+
+    m_lru.push_front(key);
+    entry e = {geometry, geometry->bytes(), m_lru.begin()};
+    m_entries[key] = e;
+    m_bytes += e.bytes;
+    evict();
+
+    /* The mesh used for loading becomes the first instance, mesh ids stay dense */
+    if (loaded) {
+        *loaded = tmp;
+    }
+    return geometry;
+}
+
+std::shared_ptr<mesh> asset_manager::load_mesh(const std::string mesh_file) {
+    std::shared_ptr<mesh> ret;
+    auto geometry = load(mesh_file, &ret);
+    if (!geometry) {
+        return nullptr;
+    }
+
+    if (ret) {
+        return ret;
+    }
+
+    ret = std::make_shared<mesh>(geometry);
+    ret->file_path = mesh_file;
+    return ret;
+}
+
+bool asset_manager::contains(const std::string mesh_file) {
+    std::string key = canonical_path(mesh_file);
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_entries.find(key) != m_entries.end();
+}
+
+void asset_manager::remove(const std::string mesh_file) {
+    std::string key = canonical_path(mesh_file);
+    std::lock_guard<std::mutex> guard(m_lock);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    m_bytes -= it->second.bytes;
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+}
+
+void asset_manager::clear() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_entries.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+void asset_manager::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_budget = bytes;
+    evict();
+}
+
+size_t asset_manager::get_bytes() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_bytes;
+}
+
+size_t asset_manager::size() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_entries.size();
+}
+
+/* m_lock is held by the caller */
+void asset_manager::evict() {
+    auto it = m_lru.end();
+    while (m_bytes > m_budget && it != m_lru.begin()) {
+        --it;
+        auto &e = m_entries.at(*it);
+        if (e.geometry.use_count() > 1) {
+            continue;
+        }
+
+        DBG("Evict {} ({} bytes)", *it, e.bytes);
+        m_bytes -= e.bytes;
+        m_entries.erase(*it);
+        it = m_lru.erase(it);
+    }
+}
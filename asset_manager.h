@@ -0,0 +1,70 @@
+/* Process-wide geometry cache
+ *
+ *  Maps a canonical mesh path to shared, immutable mesh_geometry. Every
+ *  mesh created through it is a new instance (world matrix, colors, caster
+ *  flag) on top of the shared vertex data, so N instances cost one copy on
+ *  the CPU and, through shader's buffer cache, one VBO on the GPU.
+ *
+ *  Entries are evicted in LRU order once the cached bytes exceed the budget.
+ *  Geometry still used by a mesh is never evicted, dropping it would not
+ *  free anything.
+ * */
+#pragma once
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <common.h>
+
+#include "Render/mesh.h"
+
+class asset_manager {
+public:
+    ~asset_manager() {};
+
+    static asset_manager* instance() {
+        /* Loader tasks on thread_pool may be the first callers */
+        static asset_manager *inst = new asset_manager();
+        return inst;
+    }
+
+    /* nullptr if the file cannot be loaded */
+    std::shared_ptr<mesh_geometry> load_geometry(const std::string mesh_file);
+
+    /* New instance sharing the cached geometry */
+    std::shared_ptr<mesh> load_mesh(const std::string mesh_file);
+
+    bool contains(const std::string mesh_file);
+    void remove(const std::string mesh_file);
+    void clear();
+
+    /* Memory budget in bytes */
+    void set_budget(size_t bytes);
+    size_t get_budget() { return m_budget; }
+    size_t get_bytes();
+    size_t size();
+
+    /* Statistics */
+    size_t hits() { return m_hits; }
+    size_t misses() { return m_misses; }
+    void reset_stats() { m_hits = m_misses = 0; }
+
+private:
+    asset_manager() = default;
+    std::string canonical_path(const std::string mesh_file);
+    std::shared_ptr<mesh_geometry> load(const std::string mesh_file, std::shared_ptr<mesh> *loaded);
+    void evict();
+
+private:
+    struct entry {
+        std::shared_ptr<mesh_geometry> geometry;
+        size_t bytes;
+        std::list<std::string>::iterator lru;
+    };
+
+    std::mutex m_lock;
+    std::unordered_map<std::string, entry> m_entries;
+    std::list<std::string> m_lru;         /* front is the most recently used */
+    size_t m_budget = (size_t)2 << 30;
+    size_t m_bytes = 0;
+    std::atomic<size_t> m_hits{0}, m_misses{0};
+};
@@ -42,6 +42,11 @@ void render_engine::clear_scene() {
 
 
 void render_engine::render(int iter) {
+    /* Background loads are swapped in on the render thread */
+    for (auto &s:m_scenes) {
+        s->process_async_loads();
+    }
+
     auto cur_scene = m_scenes[m_cur_scene_ind];
 
     m_renderer->render(cur_scene, m_cur_ppc);
@@ -69,6 +74,10 @@ mesh_id render_engine::add_mesh(std::shared_ptr<mesh> mesh_ptr, draw_type type)
     return cur_mesh->get_id();
 }
 
+mesh_load_handle render_engine::add_mesh_async(const std::string mesh_file, glm::vec3 color, mesh_ready_callback on_ready) {
+    return get_cur_scene()->add_mesh_async(mesh_file, color, on_ready);
+}
+
 bool render_engine::to_json(std::string) {
     // TODO
     return true;
@@ -215,4 +224,20 @@ void render_engine::set_OIT(bool trigger) {
     m_renderer->set_OIT(trigger);
 }
 
+void render_engine::set_instancing(bool trigger) {
+    m_renderer->set_instancing(trigger);
+}
+
+void render_engine::set_indirect(bool trigger) {
+    m_renderer->set_indirect(trigger);
+}
+
+void render_engine::set_culling(bool trigger) {
+    m_renderer->set_culling(trigger);
+}
+
+const frame_stats& render_engine::get_frame_stats() const {
+    return m_renderer->get_frame_stats();
+}
+
 
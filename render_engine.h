@@ -35,6 +35,7 @@ public: /* API */
     std::shared_ptr<scene> get_cur_scene();
     mesh_id add_mesh(const std::string mesh_file, glm::vec3 color= default_mesh_color);
     mesh_id add_mesh(std::shared_ptr<mesh> mesh_ptr, draw_type type);
+    mesh_load_handle add_mesh_async(const std::string mesh_file, glm::vec3 color=default_mesh_color, mesh_ready_callback on_ready=nullptr);
     bool remove_mesh(mesh_id id);
     std::shared_ptr<mesh> get_mesh(mesh_id id);
     glm::mat4 get_obj_toworld(mesh_id id);
@@ -43,6 +44,10 @@ public: /* API */
     /* Render */
     void set_render_type(mesh_id id, draw_type type);
     void set_OIT(bool trigger);
+    void set_instancing(bool trigger);
+    void set_indirect(bool trigger);
+    void set_culling(bool trigger);
+    const frame_stats& get_frame_stats() const;
 
     /* Camera */
     void camera_press(int x, int y);